@@ -0,0 +1,28 @@
+#ifndef MCU_BENCH_H
+#define MCU_BENCH_H
+
+// Reports are formatted but not printed : the benchmarks measure the framework, not the terminal
+int mcu_bench_sink(const char* format, ...);
+#define CUSTOM_PRINT_METHOD mcu_bench_sink
+
+#include <minicutest/minicutest.h>
+
+
+static volatile int mcu_bench_one = 1;
+
+// Object-like macros : an assertion passed as macro argument would be expanded before the repetition
+#define MCU_BENCH_ASSERT mcu_assert_equal_int(mcu_bench_one, 1);
+#define MCU_BENCH_ASSERT_10 MCU_BENCH_ASSERT MCU_BENCH_ASSERT MCU_BENCH_ASSERT MCU_BENCH_ASSERT MCU_BENCH_ASSERT \
+                            MCU_BENCH_ASSERT MCU_BENCH_ASSERT MCU_BENCH_ASSERT MCU_BENCH_ASSERT MCU_BENCH_ASSERT
+#define MCU_BENCH_ASSERT_100 MCU_BENCH_ASSERT_10 MCU_BENCH_ASSERT_10 MCU_BENCH_ASSERT_10 MCU_BENCH_ASSERT_10 MCU_BENCH_ASSERT_10 \
+                             MCU_BENCH_ASSERT_10 MCU_BENCH_ASSERT_10 MCU_BENCH_ASSERT_10 MCU_BENCH_ASSERT_10 MCU_BENCH_ASSERT_10
+
+///
+/// \brief test_case of 100 passing assertions, unit of the generated test_suites
+///
+#define MCU_BENCH_CASE(name) \
+    TEST_CASE_BEGIN(name) \
+        MCU_BENCH_ASSERT_100 \
+    TEST_CASE_END()
+
+#endif // MCU_BENCH_H
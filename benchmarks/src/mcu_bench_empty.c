@@ -0,0 +1,3 @@
+// Baseline of the compile time and .text size measurements : the framework with no test_case
+
+#include <mcu_bench.h>
@@ -0,0 +1,235 @@
+/*  MINCUTEST  - MINImalist C UnitTEST framework
+*
+* Framework-overhead benchmarks. Prints the results as JSON on stdout :
+*  - cost of a passing and of a failing mcu_assert_equal_int, of a TEST_CASE_BEGIN/END pair
+*    and of a test_suite run in a group
+*  - for each generated test_suite : run time, compile time and .text size, also given per 1000 assertions
+*/
+
+#include <stdarg.h>
+
+#ifdef __linux__
+#include <elf.h>
+#endif
+
+#include <mcu_bench.h>
+#include <mcu_bench_config.h>
+
+
+#define MCU_BENCH_PASS_ITERATIONS (1000000)
+#define MCU_BENCH_FAIL_ITERATIONS (100000)
+#define MCU_BENCH_CASE_ITERATIONS (100000)
+#define MCU_BENCH_SUITE_ITERATIONS (1000)
+
+
+static char sink_buffer[1024];
+
+int mcu_bench_sink(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(sink_buffer, sizeof(sink_buffer), format, args);
+    va_end(args);
+    return length;
+}
+
+
+#define DECLARE_SCALE(scale) external_declare_test_suite(mcu_bench_##scale);
+MCU_BENCH_SCALES(DECLARE_SCALE)
+
+
+//-----------------------//
+//--- MICRO BENCHMARKS --//
+//-----------------------//
+
+static volatile int bench_two = 2;
+static double assert_pass_ns;
+static double assert_fail_ns;
+static double test_case_ns;
+
+
+TEST_CASE_BEGIN(assert_pass)
+
+    for (int idx = 0; idx < MCU_BENCH_PASS_ITERATIONS; ++idx)
+    {
+        mcu_assert_equal_int(mcu_bench_one, 1);
+    }
+
+TEST_CASE_END()
+
+
+TEST_CASE_BEGIN(assert_fail)
+
+    for (int idx = 0; idx < MCU_BENCH_FAIL_ITERATIONS; ++idx)
+    {
+        mcu_assert_equal_int(bench_two, 1);
+    }
+
+TEST_CASE_END()
+
+
+TEST_CASE_BEGIN(empty)
+TEST_CASE_END()
+
+
+TEST_SUITE_BEGIN(micro)
+
+    uint64_t start = mcu_time_ns();
+    test_case_run(assert_pass);
+    assert_pass_ns = (double)(mcu_time_ns() - start) / MCU_BENCH_PASS_ITERATIONS;
+
+    start = mcu_time_ns();
+    test_case_run(assert_fail);
+    assert_fail_ns = (double)(mcu_time_ns() - start) / MCU_BENCH_FAIL_ITERATIONS;
+
+    start = mcu_time_ns();
+    for (int idx = 0; idx < MCU_BENCH_CASE_ITERATIONS; ++idx)
+    {
+        test_case_run(empty);
+    }
+    test_case_ns = (double)(mcu_time_ns() - start) / MCU_BENCH_CASE_ITERATIONS;
+
+TEST_SUITE_END()
+
+
+TEST_SUITE_BEGIN(empty_suite)
+TEST_SUITE_END()
+
+
+static double bench_suite_in_group(void)
+{
+    test_group_initialize(mcu_bench);
+    const uint64_t start = mcu_time_ns();
+    for (int idx = 0; idx < MCU_BENCH_SUITE_ITERATIONS; ++idx)
+    {
+        test_suite_run(empty_suite);
+    }
+    const double elapsed = (double)(mcu_time_ns() - start);
+    test_group_finalize();
+    group_report[0] = '\0'; // Following test_suites run out of group
+    return elapsed / MCU_BENCH_SUITE_ITERATIONS;
+}
+
+
+//-----------------------//
+//--- BUILD BENCHMARKS --//
+//-----------------------//
+
+///
+/// \brief Size of the executable sections of an ELF object file
+///
+/// \return -1 if the file can not be read or is not an ELF file
+///
+static long text_size(const char* path)
+{
+    long size = -1;
+#ifdef __linux__
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    const long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* content = malloc((size_t)file_size);
+    if (content != NULL && fread(content, 1, (size_t)file_size, file) == (size_t)file_size && memcmp(content, ELFMAG, SELFMAG) == 0)
+    {
+        size = 0;
+
+#define SUM_TEXT(Ehdr, Shdr) \
+        do { \
+            const Ehdr* header = (const Ehdr*)content; \
+            const Shdr* sections = (const Shdr*)(content + header->e_shoff); \
+            for (size_t idx = 0; idx < header->e_shnum; ++idx) \
+            { \
+                if (sections[idx].sh_type == SHT_PROGBITS && (sections[idx].sh_flags & SHF_EXECINSTR)) \
+                { \
+                    size += (long)sections[idx].sh_size; \
+                } \
+            } \
+        } while (0)
+
+        if (content[EI_CLASS] == ELFCLASS64)
+        {
+            SUM_TEXT(Elf64_Ehdr, Elf64_Shdr);
+        }
+        else
+        {
+            SUM_TEXT(Elf32_Ehdr, Elf32_Shdr);
+        }
+
+#undef SUM_TEXT
+    }
+    free(content);
+    fclose(file);
+#else
+    (void)path;
+#endif
+    return size;
+}
+
+
+///
+/// \brief Compile a source file with the flags of the build, and measure it
+///
+/// \param[out] compile_ms Wall time of the compilation, -1 on error
+/// \param[out] text_bytes Size of the executable sections of the object file, -1 if unknown
+///
+static void measure_build(const char* source, double* compile_ms, long* text_bytes)
+{
+    char command[4096];
+    const char* object = MCU_BENCH_GENERATED_DIR "/mcu_bench_measure.o";
+
+    snprintf(command, sizeof(command), "%s %s -o %s", MCU_BENCH_COMPILE_COMMAND, source, object);
+    const uint64_t start = mcu_time_ns();
+    const int status = system(command);
+    *compile_ms = (status == 0) ? (double)(mcu_time_ns() - start) / 1e6 : -1.0;
+    *text_bytes = (status == 0) ? text_size(object) : -1;
+    remove(object);
+}
+
+
+int main(void)
+{
+    double baseline_compile_ms;
+    long baseline_text_bytes;
+
+    test_suite_run(micro);
+    const double suite_in_group_ns = bench_suite_in_group();
+
+    measure_build(MCU_BENCH_SOURCE_DIR "/src/mcu_bench_empty.c", &baseline_compile_ms, &baseline_text_bytes);
+
+    printf("{\n");
+    printf("  \"assert_pass_ns\": %.2f,\n", assert_pass_ns);
+    printf("  \"assert_fail_ns\": %.2f,\n", assert_fail_ns);
+    printf("  \"test_case_ns\": %.2f,\n", test_case_ns);
+    printf("  \"test_suite_in_group_ns\": %.2f,\n", suite_in_group_ns);
+    printf("  \"baseline\": { \"compile_ms\": %.1f, \"text_bytes\": %ld },\n", baseline_compile_ms, baseline_text_bytes);
+    printf("  \"scales\": [");
+
+    const char* separator = "\n";
+
+#define RUN_SCALE(scale) \
+    do { \
+        double compile_ms; \
+        long text_bytes; \
+        const uint64_t start = mcu_time_ns(); \
+        test_suite_run(mcu_bench_##scale); \
+        const double run_ns = (double)(mcu_time_ns() - start); \
+        measure_build(MCU_BENCH_GENERATED_DIR "/mcu_bench_suite_" #scale ".c", &compile_ms, &text_bytes); \
+        printf("%s    { \"assertions\": %d, \"run_ns_per_assertion\": %.2f, " \
+               "\"compile_ms\": %.1f, \"compile_ms_per_1000_assertions\": %.2f, " \
+               "\"text_bytes\": %ld, \"text_bytes_per_1000_assertions\": %.1f }", \
+               separator, scale, run_ns / scale, \
+               compile_ms, (compile_ms - baseline_compile_ms) * 1000.0 / scale, \
+               text_bytes, (double)(text_bytes - baseline_text_bytes) * 1000.0 / scale); \
+        separator = ",\n"; \
+    } while (0);
+
+    MCU_BENCH_SCALES(RUN_SCALE)
+
+    printf("\n  ]\n}\n");
+
+    return 0;
+}
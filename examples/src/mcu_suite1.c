@@ -122,6 +122,22 @@ TEST_CASE_END()
 
 
 
+TEST_CASE_BEGIN(tc9)
+
+	// Scratch memory, released at the end of the test case
+	int* squares = mcu_alloc(100 * sizeof(int));
+	for (int i = 0; i < 100; ++i)
+	{
+		squares[i] = i * i;
+	}
+	mcu_assert_equal_int(squares[9], 81);
+	mcu_assert_not_null_ptr(mcu_alloc_aligned(4096, 64));
+
+TEST_CASE_END()
+
+
+
+
 TEST_SUITE_BEGIN(mcu_suite1)
 
 	test_case_run(tc1);
@@ -131,5 +147,6 @@ TEST_SUITE_BEGIN(mcu_suite1)
 	test_case_run(tc5);
 	test_case_run(tc7);
 	test_case_run(tc8);
+	test_case_run(tc9);
 
 TEST_SUITE_END()
\ No newline at end of file
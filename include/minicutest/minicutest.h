@@ -24,9 +24,11 @@
 #ifndef __MINICUTEST_H__
 #define __MINICUTEST_H__
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 
 // For usage of do{} while(0) with NO semicolon at the end of the macro (hence user shall put semicolon after each macro call)
@@ -42,9 +44,50 @@
 ////////////////////////////////////////////////////////////////////
 
 #ifndef CUSTOM_PRINT_METHOD
-#define LOG_FUNCTION printf
+#define PRINT_FUNCTION printf
 #else
-#define LOG_FUNCTION CUSTOM_PRINT_METHOD
+#define PRINT_FUNCTION CUSTOM_PRINT_METHOD
+#endif
+
+#ifndef MCU_SOAK
+#define LOG_FUNCTION PRINT_FUNCTION
+#else
+// Runs of the soak mode are silenced
+#define LOG_FUNCTION(...) (mcu_soak_quiet ? (void)0 : (void)PRINT_FUNCTION(__VA_ARGS__))
+#endif
+
+// Compiler specific helpers
+#if defined(__GNUC__)
+#define MCU_UNLIKELY(expr) __builtin_expect(!!(expr), 0)
+#define MCU_SHARED __attribute__((weak))
+#define MCU_UNUSED_LABEL __attribute__((unused))
+#else
+#define MCU_UNLIKELY(expr) (expr)
+#define MCU_SHARED __declspec(selectany)
+#define MCU_UNUSED_LABEL
+#endif
+
+// Type of an expression, without evaluating it, to hold assertion operands in temporaries.
+// MCU_IS_FLOATING and MCU_STATIC_ASSERT check the operands at compile time (no check before C11)
+#if defined(__cplusplus)
+#include <type_traits>
+#define MCU_TYPEOF(expr) std::decay<decltype(expr)>::type
+#define MCU_IS_FLOATING(expr) (std::is_floating_point<std::decay<decltype(expr)>::type>::value)
+#define MCU_STATIC_ASSERT(cond, message) static_assert(cond, message)
+#else
+#if defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1939)
+#define MCU_TYPEOF(expr) __typeof__(expr)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 202311L
+#define MCU_TYPEOF(expr) typeof(expr)
+#else
+#error "minicutest needs __typeof__ (GCC, Clang, MSVC >= 19.39) or C23 typeof"
+#endif
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define MCU_IS_FLOATING(expr) _Generic((expr), float: 1, double: 1, long double: 1, default: 0)
+#define MCU_STATIC_ASSERT(cond, message) _Static_assert(cond, message)
+#else
+#define MCU_STATIC_ASSERT(cond, message) ((void)0)
+#endif
 #endif
 
 #ifndef VERBOSITY_USER
@@ -53,6 +96,13 @@
 
 #define VERBOSITY ( (VERBOSITY_USER & 0x01) )
 
+// Binary log backend (MCU_BINARY_LOG) : raw bytes are sent through this method instead of LOG_FUNCTION
+#ifndef CUSTOM_BINARY_WRITE_METHOD
+#define BINARY_WRITE_FUNCTION(buffer, length) fwrite((buffer), 1, (length), stdout)
+#else
+#define BINARY_WRITE_FUNCTION(buffer, length) CUSTOM_BINARY_WRITE_METHOD((buffer), (length))
+#endif
+
 
 
 ////////////////////////////////////////////////////////////////////
@@ -87,10 +137,85 @@
 #define TEST_FAILED "FAILED"
 
 
+///
+/// \brief Type of the operands of an assertion (binary log records, listener events). Suffixes match the mcu_log_values_* API
+///
+enum mcu_type_tag
+{
+    MCU_TAG_char = 1,
+    MCU_TAG_uchar,
+    MCU_TAG_short,
+    MCU_TAG_ushort,
+    MCU_TAG_int,
+    MCU_TAG_uint,
+    MCU_TAG_long,
+    MCU_TAG_ulong,
+    MCU_TAG_llong,
+    MCU_TAG_ullong,
+    MCU_TAG_string,
+    MCU_TAG_ptr,
+    MCU_TAG_size_t,
+    MCU_TAG_float,
+    MCU_TAG_double
+};
+
+
+// C type of the operands for each tag
+#define MCU_CTYPE_char char
+#define MCU_CTYPE_uchar unsigned char
+#define MCU_CTYPE_short short
+#define MCU_CTYPE_ushort unsigned short
+#define MCU_CTYPE_int int
+#define MCU_CTYPE_uint unsigned int
+#define MCU_CTYPE_long long
+#define MCU_CTYPE_ulong unsigned long
+#define MCU_CTYPE_llong long long
+#define MCU_CTYPE_ullong unsigned long long
+#define MCU_CTYPE_string const char*
+#define MCU_CTYPE_ptr const void*
+#define MCU_CTYPE_size_t size_t
+#define MCU_CTYPE_float float
+#define MCU_CTYPE_double double
+
+
+///
+/// \brief Compile-time check of an operand of an integer assertion : floating point values and integers wider
+///         than the asserted type would be silently truncated (types narrower than int are promoted, hence not checked)
+///
+#define MCU_CHECK_INTEGER_OPERAND(TYPE, value) \
+    MCU_STATIC_ASSERT(!MCU_IS_FLOATING(value) && (sizeof(MCU_CTYPE_##TYPE) < sizeof(int) || sizeof((value) + 0) <= sizeof(MCU_CTYPE_##TYPE)), \
+                      "operand of mcu_assert_*_"#TYPE" is a floating point or a wider integer")
+
+// Compile-time check of the operands for each tag used by MCU_ASSERT_EQUAL_TYPE_BASE
+#define MCU_CHECK_OPERAND_char(value) MCU_CHECK_INTEGER_OPERAND(char, value)
+#define MCU_CHECK_OPERAND_uchar(value) MCU_CHECK_INTEGER_OPERAND(uchar, value)
+#define MCU_CHECK_OPERAND_short(value) MCU_CHECK_INTEGER_OPERAND(short, value)
+#define MCU_CHECK_OPERAND_ushort(value) MCU_CHECK_INTEGER_OPERAND(ushort, value)
+#define MCU_CHECK_OPERAND_int(value) MCU_CHECK_INTEGER_OPERAND(int, value)
+#define MCU_CHECK_OPERAND_uint(value) MCU_CHECK_INTEGER_OPERAND(uint, value)
+#define MCU_CHECK_OPERAND_long(value) MCU_CHECK_INTEGER_OPERAND(long, value)
+#define MCU_CHECK_OPERAND_ulong(value) MCU_CHECK_INTEGER_OPERAND(ulong, value)
+#define MCU_CHECK_OPERAND_llong(value) MCU_CHECK_INTEGER_OPERAND(llong, value)
+#define MCU_CHECK_OPERAND_ullong(value) MCU_CHECK_INTEGER_OPERAND(ullong, value)
+#define MCU_CHECK_OPERAND_ptr(value) ((void)0)   // Non pointer operands are already rejected by the compiler
+
+
 ///
 /// \brief Array of char to store log report of TEST_GROUP
+///         With MCU_BINARY_LOG, the overview is rebuilt by the host decoder : only the "group is active" flag is kept
 ///
+#ifndef MCU_BINARY_LOG
 static char group_report[500000]; // should be long enough to hold full report
+#else
+static char group_report[1];
+#endif
+
+#ifdef MCU_SOAK
+///
+/// \brief Set while the soak mode runs test_cases, to silence LOG_FUNCTION
+///
+static int mcu_soak_quiet = 0;
+#endif
 
 
 ////////////////////////////////////////////////////////////////////
@@ -101,6 +226,119 @@ static char group_report[500000]; // should be long enough to hold full report
 
 #define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 
+
+#ifdef MCU_BINARY_LOG
+
+//-----------------------//
+//-- BINARY LOG BACKEND -//
+//-----------------------//
+
+// With MCU_BINARY_LOG defined, no printf-like formatting is done on target. Each report is a compact record
+//  [kind : 1 byte][descriptor id : 4 bytes][payload]
+// written through BINARY_WRITE_FUNCTION. Strings (file name, expression text, test names) live in descriptors
+// placed in the "mcu_log_str" section, which can be left out of the loaded image (NOLOAD/INFO in the linker script).
+// The descriptor id is the offset of the descriptor inside that section. tools/mcu_decode rebuilds the usual
+// human-readable report from the ELF file and the captured stream.
+
+#ifndef MCU_BINARY_MAX_STRING
+#define MCU_BINARY_MAX_STRING (64) // Max number of bytes sent for a string operand (<= 255)
+#endif
+
+#define MCU_BIN_MAX_PAYLOAD (1 + 2 * (1 + MCU_BINARY_MAX_STRING))
+
+#define MCU_BIN_NO_DESCRIPTOR (0xFFFFFFFFu)
+
+///
+/// \brief Kind of a record, first byte of each record of the binary stream
+///
+enum mcu_bin_record_kind
+{
+    MCU_BIN_GROUP_BEGIN = 1,  // descriptor : group name
+    MCU_BIN_GROUP_END,        // no descriptor
+    MCU_BIN_SUITE_BEGIN,      // descriptor : suite name
+    MCU_BIN_SUITE_END,        // payload : [nb_tests : u32][nb_failed : u32]
+    MCU_BIN_CASE_BEGIN,       // descriptor : case name
+    MCU_BIN_CASE_END,         // payload : [nb_tests : u32][nb_failed : u32]
+    MCU_BIN_ASSERT_FAILED,    // descriptor : message, payload : [line : u32]
+    MCU_BIN_ARRAY_FAILED,     // descriptor : message, payload : [line : u32][nb_ko : u32][size : u32]
+    MCU_BIN_VALUES,           // payload : [tag : u8][len : u8][data bytes][len : u8][expected bytes]
+    MCU_BIN_MESSAGE           // payload : [len : u8][message bytes]
+};
+
+
+// Start of the descriptor section, provided by GNU ld (define it in the linker script if the section is placed by hand)
+extern const char __start_mcu_log_str[];
+
+///
+/// \brief Declare, in the current block, the descriptor "file\0text" of a record
+///
+/// \param[in] text String literal attached to the record
+///
+#define MCU_BIN_DESCRIPTOR(text) \
+    static const char mcu_bin_descriptor[] __attribute__((section("mcu_log_str"), used, aligned(1))) = __FILE__ "\0" text
+
+///
+/// \brief Write one record on the binary stream
+///
+static inline void mcu_bin_emit(unsigned char kind, const char* descriptor, const void* payload, size_t length)
+{
+    unsigned char record[1 + 4 + MCU_BIN_MAX_PAYLOAD];
+    const uint32_t id = descriptor ? (uint32_t)(descriptor - __start_mcu_log_str) : MCU_BIN_NO_DESCRIPTOR;
+
+    record[0] = kind;
+    memcpy(record + 1, &id, sizeof(id));
+    if (length > 0)
+    {
+        memcpy(record + 5, payload, length);
+    }
+    BINARY_WRITE_FUNCTION(record, 5 + length);
+}
+
+///
+/// \brief Write a record carrying the counters of a test_case or test_suite
+///
+static inline void mcu_bin_emit_counters(unsigned char kind, size_t nb_tests, size_t nb_failed)
+{
+    const uint32_t counters[2] = { (uint32_t)nb_tests, (uint32_t)nb_failed };
+    mcu_bin_emit(kind, NULL, counters, sizeof(counters));
+}
+
+///
+/// \brief Serialize one operand as [len : u8][raw bytes]. Strings are sent by content, truncated to MCU_BINARY_MAX_STRING
+///
+static inline size_t mcu_bin_put_operand(unsigned char* out, unsigned char tag, const void* operand, size_t size)
+{
+    if (tag == MCU_TAG_string)
+    {
+        const char* string = *(const char* const*)operand;
+        operand = string;
+        size = string ? strlen(string) : 0;
+        size = (size > MCU_BINARY_MAX_STRING) ? MCU_BINARY_MAX_STRING : size;
+    }
+    out[0] = (unsigned char)size;
+    memcpy(out + 1, operand, size);
+    return 1 + size;
+}
+
+///
+/// \brief Write a record carrying the raw values of a failed comparison
+///
+static inline void mcu_bin_emit_values(unsigned char tag, const void* data, size_t data_size, const void* expected, size_t expected_size)
+{
+    unsigned char payload[MCU_BIN_MAX_PAYLOAD];
+    size_t length = 0;
+
+    payload[length++] = tag;
+    length += mcu_bin_put_operand(payload + length, tag, data, data_size);
+    length += mcu_bin_put_operand(payload + length, tag, expected, expected_size);
+    mcu_bin_emit(MCU_BIN_VALUES, NULL, payload, length);
+}
+
+#endif // MCU_BINARY_LOG
+
+
+#ifndef MCU_BINARY_LOG
+
 ///
 /// \brief Basic print/log function for assert reporting.
 ///         Builds the message with useful information of where the assert has failed and call LOG_FUNCTION
@@ -116,18 +354,35 @@ static char group_report[500000]; // should be long enough to hold full report
     LOG_FUNCTION("%s::%s::%s:%u - Assertion failed : %s \n", filename, test_suite, test_case, line, message);
 
 
+///
+/// \brief Print the summary of a failed array assertion
+///
+/// \param[in] data The first array of the comparison
+/// \param[in] expected The expected array of the comparison
+/// \param[in] nb_ko Number of indexes for which the comparison failed
+/// \param[in] size Length of the arrays
+///
+#define MCU_LOG_ARRAY_BASE(data, expected, nb_ko, size) \
+    do { \
+        char array_test_results[1024]; \
+        sprintf(array_test_results,  "\""#data" != "#expected"\" : " MAG "%u ko / %u " RESET , nb_ko, size); \
+        MCU_LOG_BASE(__FILENAME__, test_suite, __func__, __LINE__, array_test_results)  \
+    } while (0)
+
+
 ///
 /// \brief Print the expected and obtained values based on printf formatting
 ///
-/// \param[in] type The formatting type of the variables to print
+/// \param[in] format The formatting type of the variables to print
+/// \param[in] type Suffix of the mcu_log_values_* macro (unused by the text backend)
 /// \param[in] data Variable obtained
 /// \param[in] expected Variable expected
 ///
-#define MCU_LOG_VALUES(type, data, expected) \
+#define MCU_LOG_VALUES(format, type, data, expected) \
     do { \
         if (VERBOSITY) \
         { \
-            LOG_FUNCTION(MAG "Expected " #type " , obtained " #type RESET "\n", expected, data); \
+            LOG_FUNCTION(MAG "Expected " #format " , obtained " #format RESET "\n", expected, data); \
         } \
     } while (0)
 
@@ -138,6 +393,95 @@ static char group_report[500000]; // should be long enough to hold full report
     LOG_FUNCTION("%s\n", message)
 
 
+///
+/// \brief Print the header and footer of test_cases and test_suites
+///         One shall not use these MACROS. Internally called by TEST_CASE_* and TEST_SUITE_* macros
+///
+#define MCU_LOG_CASE_BEGIN(name) \
+    LOG_FUNCTION(CYN "TEST CASE %s...\n" RESET, ""#name"");  \
+    LOG_FUNCTION(CYN "---\n" RESET);
+
+#define MCU_LOG_CASE_END(nb_tests, nb_failed) \
+    if ((nb_failed) > 0)    \
+    {   \
+        LOG_FUNCTION(CYN "--- " RED TEST_FAILED RESET" - %lu tests : %lu passed, %lu failed " CYN "---\n" RESET, (nb_tests), (nb_tests) - (nb_failed), (nb_failed)); \
+        LOG_FUNCTION("\n"); \
+    }   \
+    else    \
+    {   \
+        LOG_FUNCTION(CYN "--- " GRN TEST_PASSED RESET " - %lu passed " CYN " ---\n" RESET , (nb_tests) - (nb_failed)); \
+        LOG_FUNCTION("\n"); \
+    }
+
+#define MCU_LOG_SUITE_BEGIN(name) \
+    LOG_FUNCTION(YEL "TEST SUITE %s \n" RESET, ""#name"");   \
+    LOG_FUNCTION(YEL "===========================================================\n" RESET);
+
+#define MCU_LOG_SUITE_END(nb_tests, nb_failed) \
+    if ((nb_failed) != 0) \
+    { \
+        LOG_FUNCTION( YEL "================ KO - %lu tests :  %lu passed, %lu failed =================\n\n" RESET, (nb_tests), (nb_tests) - (nb_failed), (nb_failed)); \
+    } \
+    else \
+    { \
+        LOG_FUNCTION(YEL "================ OK -  %lu passed =================\n\n" RESET, (nb_tests)); \
+    }
+
+#else // MCU_BINARY_LOG
+
+#define MCU_LOG_BASE(filename, test_suite, test_case, line, message) \
+    do { \
+        MCU_BIN_DESCRIPTOR(message); \
+        const uint32_t mcu_bin_line = (uint32_t)(line); \
+        mcu_bin_emit(MCU_BIN_ASSERT_FAILED, mcu_bin_descriptor, &mcu_bin_line, sizeof(mcu_bin_line)); \
+    } while (0);
+
+#define MCU_LOG_ARRAY_BASE(data, expected, nb_ko, size) \
+    do { \
+        MCU_BIN_DESCRIPTOR("\""#data" != "#expected"\""); \
+        const uint32_t mcu_bin_array[3] = { (uint32_t)__LINE__, (uint32_t)(nb_ko), (uint32_t)(size) }; \
+        mcu_bin_emit(MCU_BIN_ARRAY_FAILED, mcu_bin_descriptor, mcu_bin_array, sizeof(mcu_bin_array)); \
+    } while (0)
+
+#define MCU_LOG_VALUES(format, type, data, expected) \
+    do { \
+        if (VERBOSITY) \
+        { \
+            MCU_CTYPE_##type const mcu_bin_data = (data); \
+            MCU_CTYPE_##type const mcu_bin_expected = (expected); \
+            mcu_bin_emit_values(MCU_TAG_##type, &mcu_bin_data, sizeof(mcu_bin_data), &mcu_bin_expected, sizeof(mcu_bin_expected)); \
+        } \
+    } while (0)
+
+#define mcu_log(message) \
+    do { \
+        unsigned char mcu_bin_message[1 + MCU_BINARY_MAX_STRING]; \
+        const char* mcu_bin_string = (message); \
+        mcu_bin_emit(MCU_BIN_MESSAGE, NULL, mcu_bin_message, mcu_bin_put_operand(mcu_bin_message, MCU_TAG_string, &mcu_bin_string, 0)); \
+    } while (0)
+
+#define MCU_LOG_CASE_BEGIN(name) \
+    { \
+        MCU_BIN_DESCRIPTOR(#name); \
+        (void)test_suite; \
+        mcu_bin_emit(MCU_BIN_CASE_BEGIN, mcu_bin_descriptor, NULL, 0); \
+    }
+
+#define MCU_LOG_CASE_END(nb_tests, nb_failed) \
+    mcu_bin_emit_counters(MCU_BIN_CASE_END, (nb_tests), (nb_failed));
+
+#define MCU_LOG_SUITE_BEGIN(name) \
+    { \
+        MCU_BIN_DESCRIPTOR(#name); \
+        mcu_bin_emit(MCU_BIN_SUITE_BEGIN, mcu_bin_descriptor, NULL, 0); \
+    }
+
+#define MCU_LOG_SUITE_END(nb_tests, nb_failed) \
+    mcu_bin_emit_counters(MCU_BIN_SUITE_END, (nb_tests), (nb_failed));
+
+#endif // MCU_BINARY_LOG
+
+
 //-----------------------//
 //------- LOG API -------//
 //-----------------------//
@@ -147,50 +491,666 @@ static char group_report[500000]; // should be long enough to hold full report
 ///         Call base macro with the right formating depending on type
 ///
 #define mcu_log_values_char(data, expected) \
-    MCU_LOG_VALUES(%c, data, expected)
+    MCU_LOG_VALUES(%c, char, data, expected)
 
 #define mcu_log_values_uchar(data, expected) \
-    MCU_LOG_VALUES(%c, data, expected)
+    MCU_LOG_VALUES(%c, uchar, data, expected)
 
 #define mcu_log_values_short(data, expected) \
-    MCU_LOG_VALUES(%i, data, expected)
+    MCU_LOG_VALUES(%i, short, data, expected)
 
 #define mcu_log_values_ushort(data, expected) \
-    MCU_LOG_VALUES(%u, data, expected)
+    MCU_LOG_VALUES(%u, ushort, data, expected)
 
 #define mcu_log_values_int(data, expected) \
-    MCU_LOG_VALUES(%i, data, expected)
+    MCU_LOG_VALUES(%i, int, data, expected)
 
 #define mcu_log_values_uint(data, expected) \
-    MCU_LOG_VALUES(%u, data, expected)
+    MCU_LOG_VALUES(%u, uint, data, expected)
 
 #define mcu_log_values_long(data, expected) \
-    MCU_LOG_VALUES(%li, data, expected)
+    MCU_LOG_VALUES(%li, long, data, expected)
 
 #define mcu_log_values_ulong(data, expected) \
-    MCU_LOG_VALUES(%lu, data, expected)
+    MCU_LOG_VALUES(%lu, ulong, data, expected)
 
 #define mcu_log_values_llong(data, expected) \
-    MCU_LOG_VALUES(%lli, data, expected)
+    MCU_LOG_VALUES(%lli, llong, data, expected)
 
 #define mcu_log_values_ullong(data, expected) \
-    MCU_LOG_VALUES(%llu, data, expected)
+    MCU_LOG_VALUES(%llu, ullong, data, expected)
 
 #define mcu_log_values_string(data, expected) \
-    MCU_LOG_VALUES(%s, data, expected)
+    MCU_LOG_VALUES(%s, string, data, expected)
 
 #define mcu_log_values_ptr(data, expected) \
-    MCU_LOG_VALUES(%p, data, expected)
+    MCU_LOG_VALUES(%p, ptr, data, expected)
 
 #define mcu_log_values_size_t(data, expected) \
-    MCU_LOG_VALUES(%lu, data, expected)
+    MCU_LOG_VALUES(%lu, size_t, data, expected)
 
 #define mcu_log_values_float(data, expected) \
-    MCU_LOG_VALUES(%f, data, expected)
+    MCU_LOG_VALUES(%f, float, data, expected)
 
 #define mcu_log_values_double(data, expected) \
-    MCU_LOG_VALUES(%lf, data, expected)
+    MCU_LOG_VALUES(%lf, double, data, expected)
+
+
+
+
+
+////////////////////////////////////////////////////////////////////
+///                                                              ///
+///                       EVENT LISTENERS                        ///
+///                                                              ///
+////////////////////////////////////////////////////////////////////
+
+// Listeners receive structured events (test_suite/test_case begin and end, passed and failed assertions)
+// instead of parsing the text report. Several listeners can be registered, they are called in registration order.
+// When no registered listener handles an event kind, notifying it costs one predictable branch.
+// MCU_DISABLE_PASS_LISTENERS removes the "assertion passed" notifications at compile time, MCU_DISABLE_LISTENERS removes all of them.
+// Registered listeners are shared by all the translation units of the test binary.
+
+///
+/// \brief Kinds of events
+///
+enum mcu_event_kind
+{
+    MCU_EVENT_SUITE_BEGIN,
+    MCU_EVENT_SUITE_END,
+    MCU_EVENT_CASE_BEGIN,
+    MCU_EVENT_CASE_END,
+    MCU_EVENT_ASSERT_PASSED,
+    MCU_EVENT_ASSERT_FAILED
+};
+
+///
+/// \brief Payload of an event. Fields not relevant for the kind of event are NULL/0
+///
+struct mcu_event
+{
+    enum mcu_event_kind kind;
+    const char* test_suite;     // Name of the function of the test_suite (test_suite_<name>)
+    const char* test_case;      // Name of the function of the test_case (test_case_<name>)
+    const char* file;
+    unsigned int line;
+    const char* message;        // Assertions : failure message (expression text by default)
+    unsigned char tag;          // Assertions : enum mcu_type_tag of the operands, 0 if the assertion has no operands
+    const void* data;           // Assertions : obtained operand, of type MCU_CTYPE_* matching tag
+    const void* expected;       // Assertions : expected operand
+    size_t nb_tests;            // End of test_case/test_suite : counters
+    size_t nb_failed;
+};
+
+typedef void (*mcu_listener_callback)(const struct mcu_event* event, void* user_data);
+
+///
+/// \brief A listener. Callbacks may be NULL. Storage is owned by the user and shall outlive the registration
+///
+struct mcu_listener
+{
+    mcu_listener_callback suite_begin;
+    mcu_listener_callback suite_end;
+    mcu_listener_callback case_begin;
+    mcu_listener_callback case_end;
+    mcu_listener_callback assert_passed;
+    mcu_listener_callback assert_failed;
+    void* user_data;
+    struct mcu_listener* next;
+};
+
+///
+/// \brief Registered listeners, and bit (1 << kind) set if at least one of them handles the kind of event
+///
+MCU_SHARED struct mcu_listener* mcu_listeners = NULL;
+MCU_SHARED unsigned int mcu_listeners_mask = 0;
+
+
+static inline mcu_listener_callback mcu_listener_get(const struct mcu_listener* listener, enum mcu_event_kind kind)
+{
+    switch (kind)
+    {
+        case MCU_EVENT_SUITE_BEGIN: return listener->suite_begin;
+        case MCU_EVENT_SUITE_END: return listener->suite_end;
+        case MCU_EVENT_CASE_BEGIN: return listener->case_begin;
+        case MCU_EVENT_CASE_END: return listener->case_end;
+        case MCU_EVENT_ASSERT_PASSED: return listener->assert_passed;
+        case MCU_EVENT_ASSERT_FAILED: return listener->assert_failed;
+    }
+    return NULL;
+}
+
+static inline void mcu_listeners_update_mask(void)
+{
+    mcu_listeners_mask = 0;
+    for (const struct mcu_listener* listener = mcu_listeners; listener != NULL; listener = listener->next)
+    {
+        for (int kind = MCU_EVENT_SUITE_BEGIN; kind <= MCU_EVENT_ASSERT_FAILED; ++kind)
+        {
+            if (mcu_listener_get(listener, (enum mcu_event_kind)kind) != NULL)
+            {
+                mcu_listeners_mask |= 1u << kind;
+            }
+        }
+    }
+}
+
+///
+/// \brief Register a listener, called after the already registered ones
+///
+static inline void mcu_listener_register(struct mcu_listener* listener)
+{
+    struct mcu_listener** last = &mcu_listeners;
+    while (*last != NULL)
+    {
+        last = &(*last)->next;
+    }
+    listener->next = NULL;
+    *last = listener;
+    mcu_listeners_update_mask();
+}
+
+///
+/// \brief Unregister a listener
+///
+static inline void mcu_listener_unregister(struct mcu_listener* listener)
+{
+    for (struct mcu_listener** current = &mcu_listeners; *current != NULL; current = &(*current)->next)
+    {
+        if (*current == listener)
+        {
+            *current = listener->next;
+            break;
+        }
+    }
+    mcu_listeners_update_mask();
+}
+
+///
+/// \brief Call the listeners handling this kind of event. Called by MCU_NOTIFY
+///
+static inline void mcu_listeners_notify(const struct mcu_event* event)
+{
+    for (const struct mcu_listener* listener = mcu_listeners; listener != NULL; listener = listener->next)
+    {
+        const mcu_listener_callback callback = mcu_listener_get(listener, event->kind);
+        if (callback != NULL)
+        {
+            callback(event, listener->user_data);
+        }
+    }
+}
+
+
+#ifndef MCU_DISABLE_LISTENERS
+
+///
+/// \brief Notify an event to the listeners, if one of them handles it
+///         One shall not use this MACRO. Internally called by test_case, test_suite and assert macros
+///
+/// \param[in] event_kind Kind of the event
+/// \param[in] ... Fields of struct mcu_event following kind, in declaration order
+///
+#define MCU_NOTIFY(event_kind, ...) \
+    do { \
+        if (MCU_UNLIKELY(mcu_listeners_mask & (1u << (event_kind)))) \
+        { \
+            const struct mcu_event mcu_event = { (event_kind), __VA_ARGS__ }; \
+            mcu_listeners_notify(&mcu_event); \
+        } \
+    } while (0)
+
+#else
+
+#define MCU_NOTIFY(event_kind, ...) do { } while (0)
+
+#endif // MCU_DISABLE_LISTENERS
+
+
+// Assertions are also recorded by the flight recorder (MCU_FLIGHT_RECORDER), even without listeners
+#define MCU_NOTIFY_ASSERT_FAILED(test_suite, test_case, message, tag, data_ptr, expected_ptr) \
+    do { \
+        MCU_FLIGHT_RECORD(0, test_suite, test_case, message, tag, data_ptr, expected_ptr); \
+        MCU_NOTIFY(MCU_EVENT_ASSERT_FAILED, (test_suite), (test_case), __FILENAME__, __LINE__, (message), (tag), (data_ptr), (expected_ptr), 0, 0); \
+    } while (0)
+
+#ifndef MCU_DISABLE_PASS_LISTENERS
+#define MCU_NOTIFY_ASSERT_PASSED(test_suite, test_case, message, tag, data_ptr, expected_ptr) \
+    do { \
+        MCU_FLIGHT_RECORD(1, test_suite, test_case, message, tag, data_ptr, expected_ptr); \
+        MCU_NOTIFY(MCU_EVENT_ASSERT_PASSED, (test_suite), (test_case), __FILENAME__, __LINE__, (message), (tag), (data_ptr), (expected_ptr), 0, 0); \
+    } while (0)
+#else
+#define MCU_NOTIFY_ASSERT_PASSED(test_suite, test_case, message, tag, data_ptr, expected_ptr) \
+    MCU_FLIGHT_RECORD(1, test_suite, test_case, message, tag, data_ptr, expected_ptr)
+#endif
+
+
+
+
+////////////////////////////////////////////////////////////////////
+///                                                              ///
+///                       FLIGHT RECORDER                        ///
+///                                                              ///
+////////////////////////////////////////////////////////////////////
+
+// With MCU_FLIGHT_RECORDER, each thread records its last MCU_FLIGHT_RECORDER_SIZE assertions (passed or failed,
+// with their operands) in its own ring buffer, whatever the verbosity. When the test binary crashes (SIGSEGV, SIGBUS,
+// SIGILL, SIGFPE, SIGABRT), the rings are dumped on MCU_FLIGHT_RECORDER_FD with async-signal-safe calls only, showing
+// what the test_case did right before the crash.
+// Rings are taken in a fixed table of MCU_FLIGHT_RECORDER_THREADS by the first assertion of a thread, without lock :
+// each ring has a single writer. Rings are not reused when their thread exits, assertions of threads beyond the table are not recorded.
+// The handlers are installed by the first TEST_SUITE_BEGIN, or by mcu_flight_recorder_install().
+
+#ifdef MCU_FLIGHT_RECORDER
+
+#include <signal.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define MCU_FLIGHT_WRITE(fd, buffer, length) ((void)!write((fd), (buffer), (length)))
+#else
+// No write(2) : best effort, fwrite is not async-signal-safe
+#define MCU_FLIGHT_WRITE(fd, buffer, length) ((void)fwrite((buffer), 1, (length), stderr))
+#endif
+
+#ifndef MCU_FLIGHT_RECORDER_SIZE
+#define MCU_FLIGHT_RECORDER_SIZE (64)    // Power of two
+#endif
+
+#ifndef MCU_FLIGHT_RECORDER_THREADS
+#define MCU_FLIGHT_RECORDER_THREADS (16)
+#endif
+
+#ifndef MCU_FLIGHT_RECORDER_FD
+#define MCU_FLIGHT_RECORDER_FD (2)
+#endif
+
+#define MCU_FLIGHT_RECORDER_STRING (16)  // Bytes kept of string operands, including the terminating '\0'
+
+#if defined(__cplusplus)
+#define MCU_THREAD_LOCAL thread_local
+#elif defined(__GNUC__)
+#define MCU_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define MCU_THREAD_LOCAL __declspec(thread)
+#else
+#define MCU_THREAD_LOCAL _Thread_local
+#endif
+
+#if defined(__GNUC__)
+#define MCU_FLIGHT_TAKE_SLOT(counter) __atomic_fetch_add(&(counter), 1U, __ATOMIC_RELAXED)
+#define MCU_FLIGHT_PUBLISH() __atomic_signal_fence(__ATOMIC_RELEASE)
+#else
+// No atomics : threads shall take their first assertion one after the other
+#define MCU_FLIGHT_TAKE_SLOT(counter) ((counter)++)
+#define MCU_FLIGHT_PUBLISH() do { } while (0)
+#endif
+
+///
+/// \brief An operand copied at record time, interpreted according to the tag of the record
+///
+union mcu_flight_operand
+{
+    long long signed_value;
+    unsigned long long unsigned_value;
+    double floating_value;
+    const void* pointer;
+    char string[MCU_FLIGHT_RECORDER_STRING];
+};
+
+struct mcu_flight_record
+{
+    const char* file;           // __FILE__, the path is stripped at dump time
+    const char* test_suite;
+    const char* test_case;
+    const char* message;
+    unsigned int line;
+    unsigned char passed;
+    unsigned char tag;          // enum mcu_type_tag, 0 if the assertion has no operands
+    union mcu_flight_operand data;
+    union mcu_flight_operand expected;
+};
+
+struct mcu_flight_ring
+{
+    struct mcu_flight_record records[MCU_FLIGHT_RECORDER_SIZE];
+    volatile unsigned long count;   // Number of assertions recorded, the next one goes in records[count % MCU_FLIGHT_RECORDER_SIZE]
+};
+
+struct mcu_flight_recorder_state
+{
+    struct mcu_flight_ring rings[MCU_FLIGHT_RECORDER_THREADS];
+    unsigned int nb_rings;
+    int installed;
+};
+
+MCU_SHARED struct mcu_flight_recorder_state mcu_flight_recorder;
+
+// Ring of the calling thread, NULL until its first assertion. mcu_flight_unrecorded is set if the table was full
+MCU_SHARED MCU_THREAD_LOCAL struct mcu_flight_ring* mcu_flight_ring_self;
+MCU_SHARED MCU_THREAD_LOCAL int mcu_flight_unrecorded;
+
+
+static inline void mcu_flight_copy_operand(union mcu_flight_operand* destination, unsigned char tag, const void* operand)
+{
+    switch (tag)
+    {
+        case MCU_TAG_char: destination->signed_value = *(const char*)operand; break;
+        case MCU_TAG_uchar: destination->unsigned_value = *(const unsigned char*)operand; break;
+        case MCU_TAG_short: destination->signed_value = *(const short*)operand; break;
+        case MCU_TAG_ushort: destination->unsigned_value = *(const unsigned short*)operand; break;
+        case MCU_TAG_int: destination->signed_value = *(const int*)operand; break;
+        case MCU_TAG_uint: destination->unsigned_value = *(const unsigned int*)operand; break;
+        case MCU_TAG_long: destination->signed_value = *(const long*)operand; break;
+        case MCU_TAG_ulong: destination->unsigned_value = *(const unsigned long*)operand; break;
+        case MCU_TAG_llong: destination->signed_value = *(const long long*)operand; break;
+        case MCU_TAG_ullong: destination->unsigned_value = *(const unsigned long long*)operand; break;
+        case MCU_TAG_size_t: destination->unsigned_value = *(const size_t*)operand; break;
+        case MCU_TAG_float: destination->floating_value = *(const float*)operand; break;
+        case MCU_TAG_double: destination->floating_value = *(const double*)operand; break;
+        case MCU_TAG_ptr: destination->pointer = *(const void* const*)operand; break;
+        case MCU_TAG_string:
+        {
+            const char* string = *(const char* const*)operand;
+            size_t idx = 0;
+            for (; string != NULL && idx < MCU_FLIGHT_RECORDER_STRING - 1 && string[idx] != '\0'; ++idx)
+            {
+                destination->string[idx] = string[idx];
+            }
+            destination->string[idx] = '\0';
+            break;
+        }
+        default: break;
+    }
+}
+
+///
+/// \brief Take a ring of the table for the calling thread
+///
+static inline struct mcu_flight_ring* mcu_flight_ring_take(void)
+{
+    const unsigned int slot = MCU_FLIGHT_TAKE_SLOT(mcu_flight_recorder.nb_rings);
+    if (slot >= MCU_FLIGHT_RECORDER_THREADS)
+    {
+        mcu_flight_unrecorded = 1;
+        return NULL;
+    }
+    mcu_flight_ring_self = &mcu_flight_recorder.rings[slot];
+    return mcu_flight_ring_self;
+}
+
+///
+/// \brief Record an assertion in the ring of the calling thread. Called by MCU_NOTIFY_ASSERT_* macros
+///
+static inline void mcu_flight_record(const char* file, unsigned int line, const char* test_suite, const char* test_case,
+                                     const char* message, int passed, unsigned char tag, const void* data, const void* expected)
+{
+    struct mcu_flight_ring* ring = mcu_flight_ring_self;
+    if (MCU_UNLIKELY(ring == NULL))
+    {
+        if (mcu_flight_unrecorded || (ring = mcu_flight_ring_take()) == NULL)
+        {
+            return;
+        }
+    }
+    struct mcu_flight_record* record = &ring->records[ring->count % MCU_FLIGHT_RECORDER_SIZE];
+    record->file = file;
+    record->line = line;
+    record->test_suite = test_suite;
+    record->test_case = test_case;
+    record->message = message;
+    record->passed = (unsigned char)passed;
+    record->tag = tag;
+    if (tag != 0)
+    {
+        mcu_flight_copy_operand(&record->data, tag, data);
+        mcu_flight_copy_operand(&record->expected, tag, expected);
+    }
+    MCU_FLIGHT_PUBLISH();   // A signal handler interrupting the thread sees the record complete or not counted
+    ring->count = ring->count + 1;
+}
+
+
+//-----------------------//
+//-- ASYNC-SIGNAL DUMP --//
+//-----------------------//
 
+// No stdio in the dump : the lines are formatted by hand and written with write(2)
+
+static inline void mcu_flight_put_string(int fd, const char* string)
+{
+    if (string != NULL)
+    {
+        MCU_FLIGHT_WRITE(fd, string, strlen(string));
+    }
+}
+
+static inline void mcu_flight_put_unsigned(int fd, unsigned long long value, unsigned int base)
+{
+    char digits[24];
+    size_t position = sizeof(digits);
+    do
+    {
+        digits[--position] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value != 0);
+    MCU_FLIGHT_WRITE(fd, digits + position, sizeof(digits) - position);
+}
+
+static inline void mcu_flight_put_signed(int fd, long long value)
+{
+    if (value < 0)
+    {
+        mcu_flight_put_string(fd, "-");
+        mcu_flight_put_unsigned(fd, 0ULL - (unsigned long long)value, 10);
+    }
+    else
+    {
+        mcu_flight_put_unsigned(fd, (unsigned long long)value, 10);
+    }
+}
+
+// Fixed notation with 6 decimals, enough to compare the operands of an assertion
+static inline void mcu_flight_put_double(int fd, double value)
+{
+    if (value != value)
+    {
+        mcu_flight_put_string(fd, "nan");
+        return;
+    }
+    if (value < 0)
+    {
+        mcu_flight_put_string(fd, "-");
+        value = -value;
+    }
+    if (value >= 1e18)
+    {
+        mcu_flight_put_string(fd, ">=1e18");
+        return;
+    }
+    unsigned long long integer = (unsigned long long)value;
+    unsigned long long decimals = (unsigned long long)((value - (double)integer) * 1e6 + 0.5);
+    if (decimals >= 1000000ULL)
+    {
+        integer += 1;
+        decimals -= 1000000ULL;
+    }
+    char fraction[8] = ".000000";
+    for (size_t position = 6; position > 0; --position)
+    {
+        fraction[position] = (char)('0' + decimals % 10);
+        decimals /= 10;
+    }
+    mcu_flight_put_unsigned(fd, integer, 10);
+    MCU_FLIGHT_WRITE(fd, fraction, 7);
+}
+
+static inline void mcu_flight_put_operand(int fd, unsigned char tag, const union mcu_flight_operand* operand)
+{
+    switch (tag)
+    {
+        case MCU_TAG_char: case MCU_TAG_short: case MCU_TAG_int: case MCU_TAG_long: case MCU_TAG_llong:
+            mcu_flight_put_signed(fd, operand->signed_value);
+            break;
+        case MCU_TAG_float: case MCU_TAG_double:
+            mcu_flight_put_double(fd, operand->floating_value);
+            break;
+        case MCU_TAG_ptr:
+            mcu_flight_put_string(fd, "0x");
+            mcu_flight_put_unsigned(fd, (unsigned long long)(uintptr_t)operand->pointer, 16);
+            break;
+        case MCU_TAG_string:
+            mcu_flight_put_string(fd, "\"");
+            mcu_flight_put_string(fd, operand->string);
+            mcu_flight_put_string(fd, "\"");
+            break;
+        default:
+            mcu_flight_put_unsigned(fd, operand->unsigned_value, 10);
+            break;
+    }
+}
+
+///
+/// \brief Write the rings of all the threads on fd, oldest assertion first. Async-signal-safe
+///
+/// \param[in] signal_number Signal that triggered the dump, 0 if called outside of a handler
+///
+static inline void mcu_flight_recorder_dump(int fd, int signal_number)
+{
+    unsigned int nb_rings = mcu_flight_recorder.nb_rings;
+    nb_rings = (nb_rings > MCU_FLIGHT_RECORDER_THREADS) ? MCU_FLIGHT_RECORDER_THREADS : nb_rings;
+
+    mcu_flight_put_string(fd, "\n==== Flight recorder : last assertions");
+    if (signal_number != 0)
+    {
+        mcu_flight_put_string(fd, " before signal ");
+        mcu_flight_put_unsigned(fd, (unsigned long long)signal_number, 10);
+    }
+    mcu_flight_put_string(fd, " ====\n");
+
+    for (unsigned int slot = 0; slot < nb_rings; ++slot)
+    {
+        const struct mcu_flight_ring* ring = &mcu_flight_recorder.rings[slot];
+        const unsigned long count = ring->count;
+        // The oldest slot may be overwritten by the interrupted thread : it is not dumped
+        const unsigned long nb_records = (count < MCU_FLIGHT_RECORDER_SIZE) ? count : MCU_FLIGHT_RECORDER_SIZE - 1;
+
+        mcu_flight_put_string(fd, "---- Thread #");
+        mcu_flight_put_unsigned(fd, slot, 10);
+        mcu_flight_put_string(fd, (ring == mcu_flight_ring_self && signal_number != 0) ? " (signaled)" : "");
+        mcu_flight_put_string(fd, " : ");
+        mcu_flight_put_unsigned(fd, count, 10);
+        mcu_flight_put_string(fd, " assertions ----\n");
+
+        for (unsigned long idx = count - nb_records; idx != count; ++idx)
+        {
+            const struct mcu_flight_record* record = &ring->records[idx % MCU_FLIGHT_RECORDER_SIZE];
+            const char* file = record->file;
+            for (const char* character = record->file; *character != '\0'; ++character)
+            {
+                file = (*character == '/' || *character == '\\') ? character + 1 : file;
+            }
+            mcu_flight_put_string(fd, record->passed ? "  [PASSED] " : "  [FAILED] ");
+            mcu_flight_put_string(fd, file);
+            mcu_flight_put_string(fd, ":");
+            mcu_flight_put_unsigned(fd, record->line, 10);
+            mcu_flight_put_string(fd, " ");
+            mcu_flight_put_string(fd, record->test_suite);
+            mcu_flight_put_string(fd, "::");
+            mcu_flight_put_string(fd, record->test_case);
+            mcu_flight_put_string(fd, " ");
+            mcu_flight_put_string(fd, record->message);
+            if (record->tag != 0)
+            {
+                mcu_flight_put_string(fd, " : obtained ");
+                mcu_flight_put_operand(fd, record->tag, &record->data);
+                mcu_flight_put_string(fd, ", expected ");
+                mcu_flight_put_operand(fd, record->tag, &record->expected);
+            }
+            mcu_flight_put_string(fd, "\n");
+        }
+    }
+    mcu_flight_put_string(fd, "====\n");
+}
+
+
+#if defined(SA_RESETHAND) && defined(SA_ONSTACK)
+
+static void mcu_flight_recorder_handler(int signal_number)
+{
+    mcu_flight_recorder_dump(MCU_FLIGHT_RECORDER_FD, signal_number);
+    raise(signal_number);   // Default action restored by SA_RESETHAND, e.g. core dump
+}
+
+///
+/// \brief Install the crash handlers, on an alternate stack to dump after a stack overflow too. Done once
+///
+static inline void mcu_flight_recorder_install(void)
+{
+    static unsigned char alternate_stack[65536];
+    if (mcu_flight_recorder.installed)
+    {
+        return;
+    }
+    mcu_flight_recorder.installed = 1;
+
+    stack_t stack;
+    memset(&stack, 0, sizeof(stack));
+    stack.ss_sp = alternate_stack;
+    stack.ss_size = sizeof(alternate_stack);
+    sigaltstack(&stack, NULL);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = mcu_flight_recorder_handler;
+    action.sa_flags = SA_RESETHAND | SA_NODEFER | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    const int signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+    for (size_t idx = 0; idx < sizeof(signals) / sizeof(signals[0]); ++idx)
+    {
+        sigaction(signals[idx], &action, NULL);
+    }
+}
+
+#else
+
+// No sigaction (e.g. strict ISO C) : ISO signal(), without alternate stack
+static void mcu_flight_recorder_handler(int signal_number)
+{
+    mcu_flight_recorder_dump(MCU_FLIGHT_RECORDER_FD, signal_number);
+    signal(signal_number, SIG_DFL);
+    raise(signal_number);
+}
+
+static inline void mcu_flight_recorder_install(void)
+{
+    if (mcu_flight_recorder.installed)
+    {
+        return;
+    }
+    mcu_flight_recorder.installed = 1;
+    signal(SIGSEGV, mcu_flight_recorder_handler);
+    signal(SIGILL, mcu_flight_recorder_handler);
+    signal(SIGFPE, mcu_flight_recorder_handler);
+    signal(SIGABRT, mcu_flight_recorder_handler);
+}
+
+#endif
+
+
+#define MCU_FLIGHT_RECORD(passed, test_suite, test_case, message, tag, data_ptr, expected_ptr) \
+    mcu_flight_record(__FILE__, __LINE__, (test_suite), (test_case), (message), (passed), (unsigned char)(tag), (data_ptr), (expected_ptr))
+
+#define MCU_FLIGHT_RECORDER_SUITE_BEGIN() \
+        mcu_flight_recorder_install();
+
+#else
+
+#define MCU_FLIGHT_RECORD(passed, test_suite, test_case, message, tag, data_ptr, expected_ptr) do { } while (0)
+#define MCU_FLIGHT_RECORDER_SUITE_BEGIN()
+
+#endif // MCU_FLIGHT_RECORDER
 
 
 
@@ -220,7 +1180,37 @@ static char group_report[500000]; // should be long enough to hold full report
         if ( !(expr) ) {                                \
             *nb_failed+=1;                                              \
             MCU_LOG_BASE(__FILENAME__, test_suite, test_case, __LINE__, message)  \
+            MCU_NOTIFY_ASSERT_FAILED(test_suite, test_case, message, 0, NULL, NULL); \
         }                                                             \
+        else                                                          \
+        {                                                             \
+            MCU_NOTIFY_ASSERT_PASSED(test_suite, test_case, message, 0, NULL, NULL); \
+        }                                                             \
+    } while (0)
+
+
+///
+/// \brief Same as MCU_ASSERT_BASE for assertions on two operands already evaluated in variables of type MCU_CTYPE_##TYPE
+///         Prints values in case of error (with the good format for print) and gives them to the listeners
+///         One shall not use this MACRO. Internally called by other assert macros
+///
+/// \param[in] TYPE Suffix of the mcu_log_values_* macro matching the type of the operands
+/// \param[in] data_value Variable holding the obtained value
+/// \param[in] expected_value Variable holding the expected value
+///
+#define MCU_ASSERT_OPERANDS_BASE(test_suite, test_case, TYPE, expr, message, data_value, expected_value) \
+    do { \
+        *nb_tests+=1; \
+        if ( !(expr) ) { \
+            *nb_failed+=1; \
+            MCU_LOG_BASE(__FILENAME__, test_suite, test_case, __LINE__, message) \
+            mcu_log_values_##TYPE((data_value), (expected_value)); \
+            MCU_NOTIFY_ASSERT_FAILED(test_suite, test_case, message, MCU_TAG_##TYPE, &(data_value), &(expected_value)); \
+        } \
+        else \
+        { \
+            MCU_NOTIFY_ASSERT_PASSED(test_suite, test_case, message, MCU_TAG_##TYPE, &(data_value), &(expected_value)); \
+        } \
     } while (0)
 
 
@@ -232,12 +1222,11 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 #define MCU_ASSERT_EQUAL_TYPE_BASE(TYPE, data, expected)                            \
     do { \
-        size_t nb_failed_before = *nb_failed; \
-        MCU_ASSERT_BASE(test_suite, __func__, ((data) == (expected)), "\""#data" == "#expected"\""); \
-        if (*nb_failed - nb_failed_before == 1) \
-        { \
-            mcu_log_values_##TYPE((data), (expected)); \
-        } \
+        MCU_CHECK_OPERAND_##TYPE(data); \
+        MCU_CHECK_OPERAND_##TYPE(expected); \
+        MCU_CTYPE_##TYPE const mcu_operand_data = (data); \
+        MCU_CTYPE_##TYPE const mcu_operand_expected = (expected); \
+        MCU_ASSERT_OPERANDS_BASE(test_suite, __func__, TYPE, (mcu_operand_data == mcu_operand_expected), "\""#data" == "#expected"\"", mcu_operand_data, mcu_operand_expected); \
     } while (0)
 
 
@@ -248,12 +1237,11 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 #define MCU_ASSERT_NOT_EQUAL_TYPE_BASE(TYPE, data, expected)                            \
     do { \
-        size_t nb_failed_before = *nb_failed; \
-        MCU_ASSERT_BASE(test_suite, __func__, (!((data) == (expected))), "\""#data" != "#expected"\""); \
-        if (*nb_failed - nb_failed_before == 1) \
-        { \
-            mcu_log_values_##TYPE((data), (expected)); \
-        } \
+        MCU_CHECK_OPERAND_##TYPE(data); \
+        MCU_CHECK_OPERAND_##TYPE(expected); \
+        MCU_CTYPE_##TYPE const mcu_operand_data = (data); \
+        MCU_CTYPE_##TYPE const mcu_operand_expected = (expected); \
+        MCU_ASSERT_OPERANDS_BASE(test_suite, __func__, TYPE, (!(mcu_operand_data == mcu_operand_expected)), "\""#data" != "#expected"\"", mcu_operand_data, mcu_operand_expected); \
     } while (0)
 
 
@@ -264,12 +1252,9 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 #define MCU_ASSERT_EQUAL_STRING_BASE(data, expected) \
     do { \
-        size_t nb_failed_before = *nb_failed; \
-        MCU_ASSERT_BASE(test_suite, __func__, (strcmp((data), (expected)) == 0), "\""#data" == "#expected"\""); \
-        if (*nb_failed - nb_failed_before == 1) \
-        { \
-            mcu_log_values_string((data), (expected)); \
-        } \
+        const char* mcu_operand_data = (data); \
+        const char* mcu_operand_expected = (expected); \
+        MCU_ASSERT_OPERANDS_BASE(test_suite, __func__, string, (strcmp(mcu_operand_data, mcu_operand_expected) == 0), "\""#data" == "#expected"\"", mcu_operand_data, mcu_operand_expected); \
     } while (0)
 
 
@@ -280,12 +1265,9 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 #define MCU_ASSERT_NOT_EQUAL_STRING_BASE(data, expected) \
     do { \
-        size_t nb_failed_before = *nb_failed; \
-        MCU_ASSERT_BASE(test_suite, __func__, (!(strcmp((data), (expected)) == 0)), "\""#data" != "#expected"\""); \
-        if (*nb_failed - nb_failed_before == 1) \
-        { \
-            mcu_log_values_string((data), (expected)); \
-        } \
+        const char* mcu_operand_data = (data); \
+        const char* mcu_operand_expected = (expected); \
+        MCU_ASSERT_OPERANDS_BASE(test_suite, __func__, string, (!(strcmp(mcu_operand_data, mcu_operand_expected) == 0)), "\""#data" != "#expected"\"", mcu_operand_data, mcu_operand_expected); \
     } while (0)
 
 
@@ -297,13 +1279,11 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 #define MCU_ASSERT_EQUAL_FLOAT_BASE(data, expected, precision) \
     do { \
-        const float float_diff = (((data) - (expected)) < 0) ? -((data) - (expected)) : ((data) - (expected)); \
-        size_t nb_failed_before = *nb_failed; \
-        MCU_ASSERT_BASE(test_suite, __func__, (float_diff <= precision), "\""#data" == "#expected"\""); \
-        if (*nb_failed - nb_failed_before == 1) \
-        { \
-            mcu_log_values_float((data), (expected)); \
-        } \
+        const float mcu_operand_data = (data); \
+        const float mcu_operand_expected = (expected); \
+        const float float_diff = ((mcu_operand_data - mcu_operand_expected) < 0) ? -(mcu_operand_data - mcu_operand_expected) : (mcu_operand_data - mcu_operand_expected); \
+        const float mcu_operand_precision = (precision); \
+        MCU_ASSERT_OPERANDS_BASE(test_suite, __func__, float, (float_diff <= mcu_operand_precision), "\""#data" == "#expected"\"", mcu_operand_data, mcu_operand_expected); \
     } while (0)
 
 
@@ -314,13 +1294,11 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 #define MCU_ASSERT_NOT_EQUAL_FLOAT_BASE(data, expected, precision) \
     do { \
-        const float float_diff = (((data) - (expected)) < 0) ? -((data) - (expected)) : ((data) - (expected)); \
-        size_t nb_failed_before = *nb_failed; \
-        MCU_ASSERT_BASE(test_suite, __func__, (float_diff > precision), "\""#data" != "#expected"\""); \
-        if (*nb_failed - nb_failed_before == 1) \
-        { \
-            mcu_log_values_float((data), (expected)); \
-        } \
+        const float mcu_operand_data = (data); \
+        const float mcu_operand_expected = (expected); \
+        const float float_diff = ((mcu_operand_data - mcu_operand_expected) < 0) ? -(mcu_operand_data - mcu_operand_expected) : (mcu_operand_data - mcu_operand_expected); \
+        const float mcu_operand_precision = (precision); \
+        MCU_ASSERT_OPERANDS_BASE(test_suite, __func__, float, (float_diff > mcu_operand_precision), "\""#data" != "#expected"\"", mcu_operand_data, mcu_operand_expected); \
     } while (0)
 
 
@@ -331,248 +1309,1362 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 #define MCU_ASSERT_EQUAL_DOUBLE_BASE(data, expected, precision) \
     do { \
-        const double double_diff = (((data) - (expected)) < 0) ? -((data) - (expected)) : ((data) - (expected)); \
-        size_t nb_failed_before = *nb_failed; \
-        MCU_ASSERT_BASE(test_suite, __func__, (double_diff <= precision), "\""#data" == "#expected"\""); \
-        if (*nb_failed - nb_failed_before == 1) \
+        const double mcu_operand_data = (data); \
+        const double mcu_operand_expected = (expected); \
+        const double double_diff = ((mcu_operand_data - mcu_operand_expected) < 0) ? -(mcu_operand_data - mcu_operand_expected) : (mcu_operand_data - mcu_operand_expected); \
+        const double mcu_operand_precision = (precision); \
+        MCU_ASSERT_OPERANDS_BASE(test_suite, __func__, double, (double_diff <= mcu_operand_precision), "\""#data" == "#expected"\"", mcu_operand_data, mcu_operand_expected); \
+    } while (0)
+
+
+///
+/// \brief Base macro for testing that two doubles are equal.
+///         Prints values in case of error (with the good format for print)
+///         One shall not use this MACRO. Internally called by other assert macros
+///
+#define MCU_ASSERT_NOT_EQUAL_DOUBLE_BASE(data, expected, precision) \
+    do { \
+        const double mcu_operand_data = (data); \
+        const double mcu_operand_expected = (expected); \
+        const double double_diff = ((mcu_operand_data - mcu_operand_expected) < 0) ? -(mcu_operand_data - mcu_operand_expected) : (mcu_operand_data - mcu_operand_expected); \
+        const double mcu_operand_precision = (precision); \
+        MCU_ASSERT_OPERANDS_BASE(test_suite, __func__, double, (double_diff > mcu_operand_precision), "\""#data" != "#expected"\"", mcu_operand_data, mcu_operand_expected); \
+    } while (0)
+
+
+///
+/// \brief Base macro for testing that two arrays are equal. This macro will test the expr for each index.
+///         data, expected and size are evaluated once : expr reads the elements through mcu_array_data and mcu_array_expected
+///         Prints values in case of error (with the good format for print)
+///         One shall not use this MACRO. Internally called by other assert macros
+///
+/// \param[in] data  The first array of the comparison
+/// \param[in] expected The expected array of the comparison. Used only for displaying failure message
+/// \param[in] expected_value Evaluated once into mcu_array_expected : pointer to the first expected element, or the expected element of _each variants
+/// \param[in] expr  the comparison expression. Must be built by calling-macro knowing in advance how to test the arrays
+/// \param[in] size Length of the arrays
+///
+#define MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, expected_value, expr, size) \
+    do \
+    { \
+        *nb_tests+=1;  \
+        MCU_TYPEOF(&(data)[0]) const mcu_array_data = &(data)[0]; \
+        MCU_TYPEOF(expected_value) const mcu_array_expected = (expected_value); \
+        const size_t mcu_array_size = (size_t)(size); \
+        unsigned int nb_array_tests_failed = 0; \
+        for (size_t idx = 0; idx < mcu_array_size; ++idx) \
+        { \
+            if ((expr)) \
+            { \
+                ++nb_array_tests_failed; \
+            } \
+        } \
+        if (nb_array_tests_failed > 0) \
+        { \
+            *nb_failed+=1; \
+            MCU_LOG_ARRAY_BASE(data, expected, nb_array_tests_failed, (unsigned int)mcu_array_size); \
+            MCU_NOTIFY_ASSERT_FAILED(test_suite, __func__, "\""#data" != "#expected"\"", 0, NULL, NULL); \
+        } \
+        else \
+        { \
+            MCU_NOTIFY_ASSERT_PASSED(test_suite, __func__, "\""#data" != "#expected"\"", 0, NULL, NULL); \
+        } \
+    } while(0)
+
+
+
+//-----------------------//
+//------ ASSERT API -----//
+//-----------------------//
+
+#define mcu_assert_true(expr) \
+    MCU_ASSERT_BASE(test_suite, __func__, (expr), "\""#expr" is not true\"")
+
+
+#define mcu_assert_false(expr) \
+    MCU_ASSERT_BASE(test_suite, __func__, !(expr), "\""#expr" is true\"")
+
+#define mcu_assert(expr) \
+    mcu_assert_true(expr)
+
+#define mcu_assert_message(expr, message) \
+    MCU_ASSERT_BASE(test_suite, __func__, (expr), message)
+
+
+
+
+#define mcu_assert_equal_char(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(char, data, expected)
+
+#define mcu_assert_not_equal_char(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(char, data, expected)
+
+
+#define mcu_assert_equal_uchar(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(uchar, data, expected)
+
+#define mcu_assert_not_equal_uchar(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(uchar, data, expected)
+
+
+#define mcu_assert_equal_short(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(short, data, expected)
+
+#define mcu_assert_not_equal_short(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(short, data, expected)
+
+
+#define mcu_assert_equal_ushort(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(ushort, data, expected)
+
+#define mcu_assert_not_equal_ushort(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ushort, data, expected)
+
+
+#define mcu_assert_equal_int(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(int, data, expected)
+
+#define mcu_assert_not_equal_int(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(int, data, expected)
+
+
+#define mcu_assert_equal_uint(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(uint, data, expected)
+
+#define mcu_assert_not_equal_uint(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(uint, data, expected)
+
+
+#define mcu_assert_equal_long(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(long, data, expected)
+
+#define mcu_assert_not_equal_long(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(long, data, expected)
+
+
+#define mcu_assert_equal_ulong(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(ulong, data, expected)
+
+#define mcu_assert_not_equal_ulong(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ulong, data, expected)
+
+
+#define mcu_assert_equal_ulong(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(ulong, data, expected)
+
+#define mcu_assert_not_equal_ulong(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ulong, data, expected)
+
+
+#define mcu_assert_equal_llong(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(llong, data, expected)
+
+#define mcu_assert_not_equal_llong(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(llong, data, expected)
+
+
+#define mcu_assert_equal_ullong(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(ullong, data, expected)
+
+#define mcu_assert_not_equal_ullong(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ullong, data, expected)
+
+
+#define mcu_assert_equal_string(data, expected) \
+    MCU_ASSERT_EQUAL_STRING_BASE(data, expected)
+
+#define mcu_assert_not_equal_string(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_STRING_BASE(data, expected)
+
+
+#define mcu_assert_equal_ptr(data, expected) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(ptr, data, expected)
+
+#define mcu_assert_not_equal_ptr(data, expected) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ptr, data, expected)
+
+#define mcu_assert_null_ptr(pointer) \
+    MCU_ASSERT_EQUAL_TYPE_BASE(ptr, pointer, NULL)
+
+#define mcu_assert_not_null_ptr(pointer) \
+    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ptr, pointer, NULL)
+
+
+#define mcu_assert_equal_size_t(data, expected) \
+    mcu_assert_equal_ulong(data, expected)
+
+#define mcu_assert_not_equal_size_t(data, expected) \
+    mcu_assert_not_equal_ulong(data, expected)
+
+
+#define mcu_assert_equal_float(data, expected, precision) \
+    MCU_ASSERT_EQUAL_FLOAT_BASE(data, expected, precision)
+
+// expects the relative_precision expressed in %
+// expects the relative_precision expressed in %
+#define mcu_assert_equal_float_rel(data, expected, rel_precision) \
+    MCU_ASSERT_EQUAL_FLOAT_BASE(data, expected, ((rel_precision) * (mcu_operand_expected < 0.0f ? -mcu_operand_expected : mcu_operand_expected)))
+
+
+#define mcu_assert_equal_double(data, expected, precision) \
+    MCU_ASSERT_EQUAL_DOUBLE_BASE(data, expected, precision)
+
+// expects the relative_precision expressed in %
+#define mcu_assert_equal_double_rel(data, expected, rel_precision) \
+    MCU_ASSERT_EQUAL_DOUBLE_BASE(data, expected, ((rel_precision) * (mcu_operand_expected < 0.0 ? -mcu_operand_expected : mcu_operand_expected)))
+
+
+
+///
+/// \brief Check if two variables are "equal" based on custom comparison function
+///
+/// \param[in] cmp_function Hookup function which does the comparison of data and expected variables
+///
+#define mcu_assert_equal_custom_cmp(cmp_function, data, expected) \
+    MCU_ASSERT_BASE(test_suite, __func__, ((cmp_function)((data), (expected))), "\""#data" == "#expected"\"")
+
+#define mcu_assert_not_equal_custom_cmp(cmp_function, data, expected) \
+    MCU_ASSERT_BASE(test_suite, __func__, !((cmp_function)((data), (expected))), "\""#data" != "#expected"\"")
+
+///
+/// \brief Check if two variables are "equal" based on custom comparison function
+///         Prints custom message if assert fails
+///
+/// \param[in] cmp_function Hookup function which does the comparison of data and expected variables
+///
+#define mcu_assert_equal_custom_cmp_message(cmp_function, data, expected, message) \
+    MCU_ASSERT_BASE(test_suite, __func__, ((cmp_function)((data), (expected))), message)
+
+
+
+#define mcu_assert_equal_int_array(data, expected, size) \
+    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, &(expected)[0], !(mcu_array_data[idx] == mcu_array_expected[idx]), size)
+
+#define mcu_assert_equal_int_array_each(data, expected, size) \
+    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, (expected), !(mcu_array_data[idx] == mcu_array_expected), size)
+
+#define mcu_assert_equal_custom_cmp_array(cmp_function, data, expected, size) \
+    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, &(expected)[0], !((cmp_function)(mcu_array_data[idx], mcu_array_expected[idx])), size)
+
+#define mcu_assert_equal_custom_cmp_array_each(cmp_function, data, expected, size) \
+    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, (expected), !((cmp_function)(mcu_array_data[idx], mcu_array_expected)), size)
+
+#define mcu_assert_equal_float_array(data, expected, precision, size) \
+    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, &(expected)[0], ((mcu_array_data[idx] - mcu_array_expected[idx]) < 0 ? (mcu_array_expected[idx] - mcu_array_data[idx]) : (mcu_array_data[idx] - mcu_array_expected[idx])) > (precision), size)
+
+#define mcu_assert_equal_float_array_each(data, expected, precision, size) \
+    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, (expected), ((mcu_array_data[idx] - mcu_array_expected) < 0 ? (mcu_array_expected - mcu_array_data[idx]) : (mcu_array_data[idx] - mcu_array_expected)) > (precision), size)
+
+
+
+
+
+
+////////////////////////////////////////////////////////////////////
+///                                                              ///
+///                       TIME MEASUREMENT                       ///
+///                                                              ///
+////////////////////////////////////////////////////////////////////
+
+///
+/// \brief Monotonic time in nanoseconds, used for timing reports
+///         Falls back on clock() (processor time) when no monotonic clock is available
+///
+static inline uint64_t mcu_time_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#else
+    return (uint64_t)clock() * (1000000000ULL / CLOCKS_PER_SEC);
+#endif
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////
+///                                                              ///
+///                         TEST CLOCK                           ///
+///                                                              ///
+////////////////////////////////////////////////////////////////////
+
+// mcu_now() and mcu_sleep() follow the real monotonic time by default. Code under test using them (retry
+// backoff, TTL caches, rate limiters...) can be run on a virtual clock instead, by calling mcu_clock_use_virtual()
+// in the test_case : time then only moves with mcu_clock_advance(), or automatically when all the threads using
+// the clock are sleeping. TEST_CASE_BEGIN and TEST_CASE_END go back to the real time and reset the virtual time to 0.
+//
+// Without MCU_CLOCK_THREADS, the virtual clock is single-threaded : mcu_sleep() advances it to the end of the sleep.
+// With MCU_CLOCK_THREADS (needs pthreads, to be defined in all translation units), mcu_sleep() blocks until the
+// virtual time reaches the end of the sleep. Threads other than the test_case's one shall call
+// mcu_clock_thread_begin() and mcu_clock_thread_end() so that automatic advance knows when all of them sleep.
+
+#ifdef MCU_CLOCK_THREADS
+#include <pthread.h>
+#ifndef MCU_CLOCK_MAX_SLEEPERS
+#define MCU_CLOCK_MAX_SLEEPERS (64)
+#endif
+#endif
+
+// nanosleep is only declared with the POSIX extensions (not with a strict -std=c99), as CLOCK_MONOTONIC
+#if (defined(__unix__) || defined(__APPLE__)) && defined(CLOCK_MONOTONIC)
+#define MCU_CLOCK_HAS_NANOSLEEP
+#endif
+
+struct mcu_clock
+{
+    int is_virtual;
+    int auto_advance;
+    uint64_t now_ns;                // Virtual time
+#ifdef MCU_CLOCK_THREADS
+    unsigned int nb_threads;        // Threads using the clock, test_case's one included
+    unsigned int nb_sleeping;
+    unsigned long generation;       // Incremented at reset to release the sleeping threads
+    uint64_t deadlines[MCU_CLOCK_MAX_SLEEPERS];  // End of the sleeps in progress, 0 if free
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+};
+
+///
+/// \brief Clock shared by all the translation units of the test binary
+///
+#ifdef MCU_CLOCK_THREADS
+MCU_SHARED struct mcu_clock mcu_clock = { 0, 0, 0, 1, 0, 0, { 0 }, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+#define MCU_CLOCK_LOCK() pthread_mutex_lock(&mcu_clock.mutex)
+#define MCU_CLOCK_UNLOCK() pthread_mutex_unlock(&mcu_clock.mutex)
+#else
+MCU_SHARED struct mcu_clock mcu_clock = { 0, 0, 0 };
+#define MCU_CLOCK_LOCK() do { } while (0)
+#define MCU_CLOCK_UNLOCK() do { } while (0)
+#endif
+
+
+///
+/// \brief Current time of the test clock, in nanoseconds
+///
+static inline uint64_t mcu_now(void)
+{
+    if (!mcu_clock.is_virtual)
+    {
+        return mcu_time_ns();
+    }
+    MCU_CLOCK_LOCK();
+    const uint64_t now = mcu_clock.now_ns;
+    MCU_CLOCK_UNLOCK();
+    return now;
+}
+
+
+#ifdef MCU_CLOCK_THREADS
+///
+/// \brief With automatic advance, if all the threads sleep, move the virtual time to the earliest end of sleep
+///         Shall be called with the clock locked
+///
+static inline void mcu_clock_try_auto_advance(void)
+{
+    if (!mcu_clock.auto_advance || mcu_clock.nb_sleeping == 0 || mcu_clock.nb_sleeping < mcu_clock.nb_threads)
+    {
+        return;
+    }
+    uint64_t earliest = 0;
+    for (size_t idx = 0; idx < MCU_CLOCK_MAX_SLEEPERS; ++idx)
+    {
+        if (mcu_clock.deadlines[idx] != 0 && (earliest == 0 || mcu_clock.deadlines[idx] < earliest))
+        {
+            earliest = mcu_clock.deadlines[idx];
+        }
+    }
+    if (earliest > mcu_clock.now_ns)
+    {
+        mcu_clock.now_ns = earliest;
+        pthread_cond_broadcast(&mcu_clock.cond);
+    }
+}
+#endif
+
+
+///
+/// \brief Sleep for duration_ns nanoseconds of the test clock
+///
+static inline void mcu_sleep(uint64_t duration_ns)
+{
+    if (!mcu_clock.is_virtual)
+    {
+#ifdef MCU_CLOCK_HAS_NANOSLEEP
+        const struct timespec duration = { (time_t)(duration_ns / 1000000000ULL), (long)(duration_ns % 1000000000ULL) };
+        nanosleep(&duration, NULL);
+#else
+        const uint64_t end = mcu_time_ns() + duration_ns;
+        while (mcu_time_ns() < end)
+        {
+        }
+#endif
+        return;
+    }
+
+#ifdef MCU_CLOCK_THREADS
+    MCU_CLOCK_LOCK();
+    const uint64_t deadline = mcu_clock.now_ns + duration_ns;
+    const unsigned long generation = mcu_clock.generation;
+    size_t slot = 0;
+    while (slot < MCU_CLOCK_MAX_SLEEPERS - 1 && mcu_clock.deadlines[slot] != 0)
+    {
+        ++slot;
+    }
+    mcu_clock.deadlines[slot] = (deadline != 0) ? deadline : 1;
+    mcu_clock.nb_sleeping += 1;
+    while (mcu_clock.now_ns < deadline && mcu_clock.is_virtual && mcu_clock.generation == generation)
+    {
+        mcu_clock_try_auto_advance();
+        if (mcu_clock.now_ns < deadline)
+        {
+            pthread_cond_wait(&mcu_clock.cond, &mcu_clock.mutex);
+        }
+    }
+    mcu_clock.deadlines[slot] = 0;
+    mcu_clock.nb_sleeping -= 1;
+    MCU_CLOCK_UNLOCK();
+#else
+    mcu_clock.now_ns += duration_ns;
+#endif
+}
+
+
+///
+/// \brief Run the current test_case on a virtual clock starting at 0
+///
+/// \param[in] auto_advance If non zero, the virtual time moves by itself when all the threads using the clock sleep
+///
+static inline void mcu_clock_use_virtual(int auto_advance)
+{
+    MCU_CLOCK_LOCK();
+    mcu_clock.is_virtual = 1;
+    mcu_clock.auto_advance = auto_advance;
+    mcu_clock.now_ns = 0;
+    MCU_CLOCK_UNLOCK();
+}
+
+///
+/// \brief Move the virtual time forward, waking up the threads whose sleep is over
+///
+static inline void mcu_clock_advance(uint64_t duration_ns)
+{
+    MCU_CLOCK_LOCK();
+    mcu_clock.now_ns += duration_ns;
+#ifdef MCU_CLOCK_THREADS
+    pthread_cond_broadcast(&mcu_clock.cond);
+#endif
+    MCU_CLOCK_UNLOCK();
+}
+
+///
+/// \brief Declare a thread, other than the test_case's one, using the clock
+///
+static inline void mcu_clock_thread_begin(void)
+{
+#ifdef MCU_CLOCK_THREADS
+    MCU_CLOCK_LOCK();
+    mcu_clock.nb_threads += 1;
+    MCU_CLOCK_UNLOCK();
+#endif
+}
+
+static inline void mcu_clock_thread_end(void)
+{
+#ifdef MCU_CLOCK_THREADS
+    MCU_CLOCK_LOCK();
+    mcu_clock.nb_threads -= 1;
+    mcu_clock_try_auto_advance();
+    MCU_CLOCK_UNLOCK();
+#endif
+}
+
+///
+/// \brief Go back to the real time, with a fresh virtual epoch. Called by TEST_CASE_BEGIN and TEST_CASE_END
+///         Threads still sleeping on the virtual clock are released
+///
+static inline void mcu_clock_reset(void)
+{
+    if (!mcu_clock.is_virtual)
+    {
+        return;
+    }
+    MCU_CLOCK_LOCK();
+    mcu_clock.is_virtual = 0;
+    mcu_clock.auto_advance = 0;
+    mcu_clock.now_ns = 0;
+#ifdef MCU_CLOCK_THREADS
+    mcu_clock.nb_threads = 1;
+    mcu_clock.generation += 1;
+    pthread_cond_broadcast(&mcu_clock.cond);
+#endif
+    MCU_CLOCK_UNLOCK();
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////
+///                                                              ///
+///                    EVENTUALLY ASSERTIONS                     ///
+///                                                              ///
+////////////////////////////////////////////////////////////////////
+
+// For asynchronous components (worker threads, flushers...) : the expression is polled until it is true or
+// the timeout, measured with the test clock (mcu_now), elapses. Polling backs off from spinning to yielding the CPU, then to sleeps of growing duration,
+// so that the assertion passes as soon as the condition holds without burning a core.
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sched.h>
+#define MCU_EVENTUALLY_HAS_POSIX
+#endif
+
+#ifndef MCU_EVENTUALLY_SPIN_POLLS
+#define MCU_EVENTUALLY_SPIN_POLLS (64)
+#endif
+
+#ifndef MCU_EVENTUALLY_YIELD_POLLS
+#define MCU_EVENTUALLY_YIELD_POLLS (64)
+#endif
+
+#ifndef MCU_EVENTUALLY_MIN_SLEEP_NS
+#define MCU_EVENTUALLY_MIN_SLEEP_NS (10000ULL)
+#endif
+
+#ifndef MCU_EVENTUALLY_MAX_SLEEP_NS
+#define MCU_EVENTUALLY_MAX_SLEEP_NS (10000000ULL)
+#endif
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define MCU_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(__arm__))
+#define MCU_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define MCU_CPU_RELAX() do { } while (0)
+#endif
+
+///
+/// \brief Wait before the next poll of an eventually assertion
+///
+/// \param[in] polls Number of polls already done
+/// \param[in] remaining_ns Time left before the timeout
+///
+static inline void mcu_eventually_backoff(unsigned long polls, uint64_t remaining_ns)
+{
+    if (polls < MCU_EVENTUALLY_SPIN_POLLS)
+    {
+        MCU_CPU_RELAX();
+        return;
+    }
+#ifdef MCU_EVENTUALLY_HAS_POSIX
+    if (polls < MCU_EVENTUALLY_SPIN_POLLS + MCU_EVENTUALLY_YIELD_POLLS)
+    {
+        sched_yield();
+        return;
+    }
+#endif
+    const unsigned long shift = polls - MCU_EVENTUALLY_SPIN_POLLS - MCU_EVENTUALLY_YIELD_POLLS;
+    uint64_t sleep_ns = (shift < 32) ? (MCU_EVENTUALLY_MIN_SLEEP_NS << shift) : MCU_EVENTUALLY_MAX_SLEEP_NS;
+    sleep_ns = (sleep_ns > MCU_EVENTUALLY_MAX_SLEEP_NS) ? MCU_EVENTUALLY_MAX_SLEEP_NS : sleep_ns;
+    sleep_ns = (sleep_ns > remaining_ns) ? remaining_ns : sleep_ns;
+    mcu_sleep(sleep_ns);
+}
+
+///
+/// \brief Base macro of eventually assertions. Polls expr until it is true or timeout_ms elapses
+///         On timeout, the assertion fails and the waited time and number of polls are printed
+///         One shall not use this MACRO. Internally called by other assert macros
+///
+/// \param[in] on_failure Statement executed after a failure
+///
+#define MCU_ASSERT_EVENTUALLY_BASE(expr, timeout_ms, on_failure) \
+    do { \
+        const uint64_t mcu_eventually_start = mcu_now(); \
+        const uint64_t mcu_eventually_timeout = (uint64_t)(timeout_ms) * 1000000ULL; \
+        unsigned long mcu_eventually_polls = 0; \
+        uint64_t mcu_eventually_elapsed = 0; \
+        int mcu_eventually_ok = 0; \
+        while (1) \
         { \
-            mcu_log_values_double((data), (expected)); \
+            ++mcu_eventually_polls; \
+            mcu_eventually_ok = !!(expr); \
+            mcu_eventually_elapsed = mcu_now() - mcu_eventually_start; \
+            if (mcu_eventually_ok || mcu_eventually_elapsed >= mcu_eventually_timeout) \
+            { \
+                break; \
+            } \
+            mcu_eventually_backoff(mcu_eventually_polls, mcu_eventually_timeout - mcu_eventually_elapsed); \
+        } \
+        MCU_ASSERT_BASE(test_suite, __func__, mcu_eventually_ok, "\""#expr" is not true after " #timeout_ms " ms\""); \
+        if (!mcu_eventually_ok) \
+        { \
+            char mcu_eventually_report[96]; \
+            snprintf(mcu_eventually_report, sizeof(mcu_eventually_report), "Waited %.3f ms, %lu polls", (double)mcu_eventually_elapsed / 1e6, mcu_eventually_polls); \
+            mcu_log(mcu_eventually_report); \
+            on_failure; \
         } \
     } while (0)
 
 
+//-----------------------//
+//------ ASSERT API -----//
+//-----------------------//
+
+///
+/// \brief Check that expr becomes true before timeout_ms milliseconds
+///
+#define mcu_assert_eventually(expr, timeout_ms) \
+    MCU_ASSERT_EVENTUALLY_BASE(expr, timeout_ms, (void)0)
+
+///
+/// \brief Same as mcu_assert_eventually, but the rest of the test_case is skipped on failure
+///
+#define mcu_require_eventually(expr, timeout_ms) \
+    MCU_ASSERT_EVENTUALLY_BASE(expr, timeout_ms, goto mcu_test_case_end)
+
+
+
+
+////////////////////////////////////////////////////////////////////
+///                                                              ///
+///                     LATENCY ASSERTIONS                       ///
+///                                                              ///
+////////////////////////////////////////////////////////////////////
+
+// Assertions on the tail latency of a function. Durations are recorded in a log-linear (HDR-style) histogram :
+// fixed memory, constant-time recording, relative precision of 2^-(MCU_HISTOGRAM_SUB_BUCKET_BITS - 1).
+// Histograms recorded by several threads can be merged and checked with mcu_assert_latency_histogram.
+
+#ifndef MCU_HISTOGRAM_SUB_BUCKET_BITS
+#define MCU_HISTOGRAM_SUB_BUCKET_BITS (7)
+#endif
+
+#ifndef MCU_HISTOGRAM_MAX_BITS
+#define MCU_HISTOGRAM_MAX_BITS (40)     // Values are clamped to 2^40 - 1 ns (about 18 minutes)
+#endif
+
+#define MCU_HISTOGRAM_SUB_BUCKETS (1U << MCU_HISTOGRAM_SUB_BUCKET_BITS)
+#define MCU_HISTOGRAM_HALF_SUB_BUCKETS (MCU_HISTOGRAM_SUB_BUCKETS / 2)
+#define MCU_HISTOGRAM_NB_BUCKETS ((MCU_HISTOGRAM_MAX_BITS - MCU_HISTOGRAM_SUB_BUCKET_BITS + 2) * MCU_HISTOGRAM_HALF_SUB_BUCKETS)
+
+struct mcu_histogram
+{
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    uint64_t counts[MCU_HISTOGRAM_NB_BUCKETS];
+};
+
+static inline void mcu_histogram_init(struct mcu_histogram* histogram)
+{
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->min = UINT64_MAX;
+}
+
+///
+/// \brief Index of the bucket of a value. Values below MCU_HISTOGRAM_SUB_BUCKETS have their own bucket,
+///         above each power of two is split in MCU_HISTOGRAM_HALF_SUB_BUCKETS linear buckets
+///
+static inline size_t mcu_histogram_index(uint64_t value)
+{
+    if (value < MCU_HISTOGRAM_SUB_BUCKETS)
+    {
+        return (size_t)value;
+    }
+#if defined(__GNUC__)
+    const unsigned int msb = 63U - (unsigned int)__builtin_clzll(value);
+#else
+    unsigned int msb = 0;
+    for (uint64_t rest = value >> 1; rest != 0; rest >>= 1)
+    {
+        ++msb;
+    }
+#endif
+    const unsigned int exponent = msb - MCU_HISTOGRAM_SUB_BUCKET_BITS + 1;
+    return (size_t)exponent * MCU_HISTOGRAM_HALF_SUB_BUCKETS + (size_t)(value >> exponent);
+}
+
+///
+/// \brief Highest value counted in a bucket
+///
+static inline uint64_t mcu_histogram_value(size_t index)
+{
+    if (index < MCU_HISTOGRAM_SUB_BUCKETS)
+    {
+        return (uint64_t)index;
+    }
+    const unsigned int exponent = (unsigned int)(index / MCU_HISTOGRAM_HALF_SUB_BUCKETS) - 1;
+    const uint64_t sub_bucket = (uint64_t)(index - (size_t)exponent * MCU_HISTOGRAM_HALF_SUB_BUCKETS);
+    return ((sub_bucket + 1) << exponent) - 1;
+}
+
+static inline void mcu_histogram_record(struct mcu_histogram* histogram, uint64_t value_ns)
+{
+    const uint64_t max_value = (1ULL << MCU_HISTOGRAM_MAX_BITS) - 1;
+    value_ns = (value_ns > max_value) ? max_value : value_ns;
+    histogram->counts[mcu_histogram_index(value_ns)] += 1;
+    histogram->total += 1;
+    histogram->sum += value_ns;
+    histogram->min = (value_ns < histogram->min) ? value_ns : histogram->min;
+    histogram->max = (value_ns > histogram->max) ? value_ns : histogram->max;
+}
+
+///
+/// \brief Add the samples of source to destination, e.g. histograms recorded by several threads
+///
+static inline void mcu_histogram_merge(struct mcu_histogram* destination, const struct mcu_histogram* source)
+{
+    for (size_t idx = 0; idx < MCU_HISTOGRAM_NB_BUCKETS; ++idx)
+    {
+        destination->counts[idx] += source->counts[idx];
+    }
+    destination->total += source->total;
+    destination->sum += source->sum;
+    destination->min = (source->min < destination->min) ? source->min : destination->min;
+    destination->max = (source->max > destination->max) ? source->max : destination->max;
+}
+
+///
+/// \brief Value under which percentile % of the samples are, rounded up to the end of its bucket (and capped by the max)
+///
+static inline uint64_t mcu_histogram_percentile(const struct mcu_histogram* histogram, double percentile)
+{
+    if (histogram->total == 0)
+    {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(percentile / 100.0 * (double)histogram->total + 0.5);
+    target = (target == 0) ? 1 : target;
+    uint64_t cumulated = 0;
+    for (size_t idx = 0; idx < MCU_HISTOGRAM_NB_BUCKETS; ++idx)
+    {
+        cumulated += histogram->counts[idx];
+        if (cumulated >= target)
+        {
+            const uint64_t value = mcu_histogram_value(idx);
+            return (value < histogram->max) ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+///
+/// \brief Print the percentile table of a histogram
+///
+static inline void mcu_histogram_log(const struct mcu_histogram* histogram)
+{
+    static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+    char line[96];
+
+    snprintf(line, sizeof(line), "  samples %llu, min %llu ns, mean %llu ns, max %llu ns",
+             (unsigned long long)histogram->total, (unsigned long long)(histogram->total ? histogram->min : 0),
+             (unsigned long long)(histogram->total ? histogram->sum / histogram->total : 0), (unsigned long long)histogram->max);
+    mcu_log(line);
+    for (size_t idx = 0; idx < sizeof(percentiles) / sizeof(percentiles[0]); ++idx)
+    {
+        snprintf(line, sizeof(line), "  p%-6g %llu ns", percentiles[idx], (unsigned long long)mcu_histogram_percentile(histogram, percentiles[idx]));
+        mcu_log(line);
+    }
+}
+
+
 ///
-/// \brief Base macro for testing that two doubles are equal.
-///         Prints values in case of error (with the good format for print)
+/// \brief Base macro of latency assertions : p99 and p99.9 of the histogram shall be strictly below the bounds
+///         Prints the percentile table in case of error
 ///         One shall not use this MACRO. Internally called by other assert macros
 ///
-#define MCU_ASSERT_NOT_EQUAL_DOUBLE_BASE(data, expected, precision) \
+#define MCU_ASSERT_LATENCY_BASE(histogram, p99_max_ns, p999_max_ns, message) \
     do { \
-        const double double_diff = (((data) - (expected)) < 0) ? -((data) - (expected)) : ((data) - (expected)); \
-        size_t nb_failed_before = *nb_failed; \
-        MCU_ASSERT_BASE(test_suite, __func__, (double_diff > precision), "\""#data" != "#expected"\""); \
-        if (*nb_failed - nb_failed_before == 1) \
+        const uint64_t mcu_latency_p99 = mcu_histogram_percentile((histogram), 99.0); \
+        const uint64_t mcu_latency_p999 = mcu_histogram_percentile((histogram), 99.9); \
+        const int mcu_latency_ok = (mcu_latency_p99 < (uint64_t)(p99_max_ns)) && (mcu_latency_p999 < (uint64_t)(p999_max_ns)); \
+        MCU_ASSERT_BASE(test_suite, __func__, mcu_latency_ok, message); \
+        if (!mcu_latency_ok) \
         { \
-            mcu_log_values_double((data), (expected)); \
+            mcu_histogram_log(histogram); \
         } \
     } while (0)
 
 
+//-----------------------//
+//------ ASSERT API -----//
+//-----------------------//
+
 ///
-/// \brief Base macro for testing that two arrays are equal. This macro will test the expr for each index.
-///         Prints values in case of error (with the good format for print)
-///         One shall not use this MACRO. Internally called by other assert macros
+/// \brief Call fn(ctx) samples times and check that the p99 and p99.9 of its duration are below the bounds
 ///
-/// \param[in] data  The first array of the comparison. Used only for displaying failure message
-/// \param[in] expected The expected array of the comparison. Used only for displaying failure message
-/// \param[in] expr  the comparison expression. Must be built by calling-macro knowing in advance how to test the arrays
-/// \param[in] size Length of the arrays
+/// \param[in] fn Function to measure, taking ctx as only parameter
+/// \param[in] ctx Pointer passed to fn
+/// \param[in] samples Number of calls
+/// \param[in] p99_max_ns The 99th percentile shall be strictly below this duration, in ns
+/// \param[in] p999_max_ns The 99.9th percentile shall be strictly below this duration, in ns
 ///
-#define MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, expr, size) \
-    do \
-    { \
-        *nb_tests+=1;  \
-        int nb_array_tests_failed = 0; \
-        for (size_t idx = 0; idx < size; ++idx) \
-        { \
-            if ((expr)) \
-            { \
-                ++nb_array_tests_failed; \
-            } \
-        } \
-        if (nb_array_tests_failed > 0) \
+#define mcu_assert_latency(fn, ctx, samples, p99_max_ns, p999_max_ns) \
+    do { \
+        struct mcu_histogram mcu_latency_histogram; \
+        void* const mcu_latency_ctx = (ctx); \
+        const size_t mcu_latency_samples = (size_t)(samples); \
+        mcu_histogram_init(&mcu_latency_histogram); \
+        for (size_t mcu_sample = 0; mcu_sample < mcu_latency_samples; ++mcu_sample) \
         { \
-            *nb_failed+=1; \
-            char array_test_results[1024]; \
-            sprintf(array_test_results,  "\""#data" != "#expected"\" : " MAG "%u ko / %u " RESET , nb_array_tests_failed, size); \
-            MCU_LOG_BASE(__FILENAME__, test_suite, __func__, __LINE__, array_test_results)  \
+            const uint64_t mcu_sample_start = mcu_time_ns(); \
+            (fn)(mcu_latency_ctx); \
+            mcu_histogram_record(&mcu_latency_histogram, mcu_time_ns() - mcu_sample_start); \
         } \
-    } while(0)
-
-
-
-//-----------------------//
-//------ ASSERT API -----//
-//-----------------------//
-
-#define mcu_assert_true(expr) \
-    MCU_ASSERT_BASE(test_suite, __func__, (expr), "\""#expr" is not true\"")
-
-
-#define mcu_assert_false(expr) \
-    MCU_ASSERT_BASE(test_suite, __func__, !(expr), "\""#expr" is true\"")
-
-#define mcu_assert(expr) \
-    mcu_assert_true(expr)
-
-#define mcu_assert_message(expr, message) \
-    MCU_ASSERT_BASE(test_suite, __func__, (expr), message)
-
-
-
+        MCU_ASSERT_LATENCY_BASE(&mcu_latency_histogram, p99_max_ns, p999_max_ns, \
+                                "\"latency of "#fn" : p99 < "#p99_max_ns" ns, p99.9 < "#p999_max_ns" ns\""); \
+    } while (0)
 
-#define mcu_assert_equal_char(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(char, data, expected)
+///
+/// \brief Check the p99 and p99.9 of an already recorded (or merged) histogram
+///
+#define mcu_assert_latency_histogram(histogram, p99_max_ns, p999_max_ns) \
+    MCU_ASSERT_LATENCY_BASE(histogram, p99_max_ns, p999_max_ns, "\"latency of "#histogram" : p99 < "#p99_max_ns" ns, p99.9 < "#p999_max_ns" ns\"")
 
-#define mcu_assert_not_equal_char(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(char, data, expected)
 
 
-#define mcu_assert_equal_uchar(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(uchar, data, expected)
 
-#define mcu_assert_not_equal_uchar(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(uchar, data, expected)
+////////////////////////////////////////////////////////////////////
+///                                                              ///
+///                    SCRATCH MEMORY ARENA                      ///
+///                                                              ///
+////////////////////////////////////////////////////////////////////
 
+// Bump allocator for the scratch buffers of a test_case. Memory given by mcu_alloc is valid until the end
+// of the current test_case : TEST_CASE_BEGIN and TEST_CASE_END reset the arena in O(1), nothing has to be freed.
+// Address space (MCU_ARENA_RESERVE) is reserved on first use and pages are committed on demand.
+// With MCU_ARENA_GUARD_PAGES, each allocation ends right before an inaccessible page so that overruns fault
+// immediately, and memory of a previous test_case becomes inaccessible after the reset.
+// Without mmap (e.g. bare-metal targets), the arena is one malloc'ed block of MCU_ARENA_RESERVE bytes and guard pages are not available.
+// The arena is not thread-safe and, as group_report, there is one arena per translation unit.
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+// MAP_ANONYMOUS is only declared with the POSIX extensions (not with a strict -std=c99)
+#if defined(MAP_ANONYMOUS)
+#define MCU_ARENA_HAS_MMAP
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#endif
+#endif
 
-#define mcu_assert_equal_short(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(short, data, expected)
+#ifndef MCU_ARENA_RESERVE
+    #ifdef MCU_ARENA_HAS_MMAP
+        #define MCU_ARENA_RESERVE (256UL * 1024UL * 1024UL)
+    #else
+        #define MCU_ARENA_RESERVE (64UL * 1024UL)
+    #endif
+#endif
 
-#define mcu_assert_not_equal_short(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(short, data, expected)
+#ifndef MCU_ARENA_COMMIT_GRANULARITY
+#define MCU_ARENA_COMMIT_GRANULARITY (64UL * 1024UL)
+#endif
 
+#ifndef MCU_ARENA_DEFAULT_ALIGNMENT
+#define MCU_ARENA_DEFAULT_ALIGNMENT (16)
+#endif
 
-#define mcu_assert_equal_ushort(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(ushort, data, expected)
+#define MCU_ALIGN_UP(value, alignment) (((value) + ((alignment) - 1)) & ~((size_t)(alignment) - 1))
 
-#define mcu_assert_not_equal_ushort(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ushort, data, expected)
+struct mcu_arena
+{
+    unsigned char* base;
+    size_t reserved;
+    size_t committed;   // Bytes accessible from base (not used with guard pages)
+    size_t position;    // Next free byte
+    size_t page_size;
+};
 
+///
+/// \brief Arena of the test_cases of the translation unit
+///
+static struct mcu_arena mcu_arena;
 
-#define mcu_assert_equal_int(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(int, data, expected)
 
-#define mcu_assert_not_equal_int(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(int, data, expected)
+///
+/// \brief Reserve the address space of the arena. Called on first allocation
+///
+/// \return 0 on success
+///
+static inline int mcu_arena_reserve(struct mcu_arena* arena)
+{
+#ifdef MCU_ARENA_HAS_MMAP
+    void* base = mmap(NULL, MCU_ARENA_RESERVE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        return -1;
+    }
+    arena->base = (unsigned char*)base;
+    arena->committed = 0;
+    arena->page_size = (size_t)sysconf(_SC_PAGESIZE);
+#else
+    arena->base = (unsigned char*)malloc(MCU_ARENA_RESERVE);
+    if (arena->base == NULL)
+    {
+        return -1;
+    }
+    arena->committed = MCU_ARENA_RESERVE;
+    arena->page_size = 1;
+#endif
+    arena->reserved = MCU_ARENA_RESERVE;
+    arena->position = 0;
+    return 0;
+}
 
 
-#define mcu_assert_equal_uint(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(uint, data, expected)
+///
+/// \brief Release all the allocations of the arena in O(1)
+///         Called by TEST_CASE_BEGIN and TEST_CASE_END
+///
+static inline void mcu_arena_reset(struct mcu_arena* arena)
+{
+#if defined(MCU_ARENA_GUARD_PAGES) && defined(MCU_ARENA_HAS_MMAP)
+    if (arena->position > 0)
+    {
+        mprotect(arena->base, arena->position, PROT_NONE);
+    }
+#endif
+    arena->position = 0;
+}
 
-#define mcu_assert_not_equal_uint(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(uint, data, expected)
 
+///
+/// \brief Allocate scratch memory valid until the end of the current test_case
+///
+/// \param[in] size Number of bytes
+/// \param[in] alignment Alignment of the returned address. Shall be a power of two
+///
+/// \return The allocated memory, or NULL if the arena is exhausted
+///
+static inline void* mcu_alloc_aligned(size_t size, size_t alignment)
+{
+    struct mcu_arena* arena = &mcu_arena;
 
-#define mcu_assert_equal_long(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(long, data, expected)
+    if (arena->base == NULL && mcu_arena_reserve(arena) != 0)
+    {
+        return NULL;
+    }
+    alignment = (alignment == 0) ? 1 : alignment;
+    if (size > arena->reserved || alignment > arena->reserved)
+    {
+        return NULL;
+    }
 
-#define mcu_assert_not_equal_long(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(long, data, expected)
+#if defined(MCU_ARENA_GUARD_PAGES) && defined(MCU_ARENA_HAS_MMAP)
+    // The block is placed at the end of its pages, followed by a guard page left inaccessible
+    const size_t first = arena->position;
+    size_t span = MCU_ALIGN_UP(size, arena->page_size);
+    size_t start = (first + span - size) & ~(alignment - 1);
+    while (start < first)
+    {
+        span += arena->page_size;
+        start = (first + span - size) & ~(alignment - 1);
+    }
+    if (first + span + arena->page_size > arena->reserved)
+    {
+        return NULL;
+    }
+    if (span > 0 && mprotect(arena->base + first, span, PROT_READ | PROT_WRITE) != 0)
+    {
+        return NULL;
+    }
+    arena->position = first + span + arena->page_size;
+    return arena->base + start;
+#else
+    const size_t start = MCU_ALIGN_UP(arena->position, alignment);
+    if (start > arena->reserved || size > arena->reserved - start)
+    {
+        return NULL;
+    }
+    const size_t end = start + size;
+    if (end > arena->committed)
+    {
+        size_t committed = MCU_ALIGN_UP(end, MCU_ARENA_COMMIT_GRANULARITY);
+        committed = (committed > arena->reserved) ? arena->reserved : committed;
+#ifdef MCU_ARENA_HAS_MMAP
+        if (mprotect(arena->base + arena->committed, committed - arena->committed, PROT_READ | PROT_WRITE) != 0)
+        {
+            return NULL;
+        }
+#endif
+        arena->committed = committed;
+    }
+    arena->position = end;
+    return arena->base + start;
+#endif
+}
 
 
-#define mcu_assert_equal_ulong(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(ulong, data, expected)
+///
+/// \brief Allocate scratch memory valid until the end of the current test_case, aligned on MCU_ARENA_DEFAULT_ALIGNMENT
+///
+static inline void* mcu_alloc(size_t size)
+{
+    return mcu_alloc_aligned(size, MCU_ARENA_DEFAULT_ALIGNMENT);
+}
 
-#define mcu_assert_not_equal_ulong(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ulong, data, expected)
 
 
-#define mcu_assert_equal_ulong(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(ulong, data, expected)
 
-#define mcu_assert_not_equal_ulong(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ulong, data, expected)
+////////////////////////////////////////////////////////////////////
+///                                                              ///
+///                          SOAK MODE                           ///
+///                                                              ///
+////////////////////////////////////////////////////////////////////
 
+// With MCU_SOAK defined, test_case_run only registers the test_case and TEST_SUITE_END runs all the registered
+// test_cases several times, optionally in a shuffled order, to find flaky test_cases. Output of the runs is
+// silenced and a report gives, for each test_case, its pass rate, the seed reproducing its first failure and
+// the coefficient of variation of its duration.
+// Each run uses its own seed : it gives the order of the test_cases and is passed to srand() before the run.
+// Statements of the test_suite other than test_case_run are executed once, at registration.
+//
+// Configuration, through environment variables (compile-time defaults in brackets) :
+//  - MCU_SOAK_ITERATIONS : number of runs [MCU_SOAK_DEFAULT_ITERATIONS]
+//  - MCU_SOAK_DURATION : max duration of the runs of a test_suite, in seconds. Without MCU_SOAK_ITERATIONS, runs until it elapses
+//  - MCU_SOAK_SHUFFLE : shuffle the test_cases at each run if non zero [MCU_SOAK_DEFAULT_SHUFFLE]
+//  - MCU_SOAK_SEED : seed of the first run. MCU_SOAK_SEED=<reported seed> MCU_SOAK_ITERATIONS=1 replays a failure
+//  - MCU_SOAK_FILTER : only run the test_cases whose name contains this string
+//  - MCU_SOAK_VERBOSE : keep the output of the runs if non zero
+
+#ifdef MCU_SOAK
+
+#ifdef MCU_BINARY_LOG
+#error "MCU_SOAK is not available with MCU_BINARY_LOG"
+#endif
 
-#define mcu_assert_equal_llong(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(llong, data, expected)
+#ifndef MCU_SOAK_MAX_CASES
+#define MCU_SOAK_MAX_CASES (256)
+#endif
 
-#define mcu_assert_not_equal_llong(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(llong, data, expected)
+#ifndef MCU_SOAK_DEFAULT_ITERATIONS
+#define MCU_SOAK_DEFAULT_ITERATIONS (10)
+#endif
 
+#ifndef MCU_SOAK_DEFAULT_SHUFFLE
+#define MCU_SOAK_DEFAULT_SHUFFLE (0)
+#endif
 
-#define mcu_assert_equal_ullong(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(ullong, data, expected)
+///
+/// \brief Registered test_case and its statistics over the runs
+///
+struct mcu_soak_case
+{
+    const char* name;
+    void (*run)(const char* const, size_t*, size_t*);
+    size_t nb_runs;
+    size_t nb_failed_runs;
+    uint64_t first_failure_seed;
+    double mean_ns;     // Welford running mean and sum of squared deviations of the durations
+    double m2_ns;
+};
 
-#define mcu_assert_not_equal_ullong(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ullong, data, expected)
+///
+/// \brief splitmix64, to derive the seeds of the runs and shuffle the test_cases
+///
+static inline uint64_t mcu_soak_next(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
 
+///
+/// \brief Square root by Newton iterations, to avoid linking with libm
+///
+static inline double mcu_soak_sqrt(double value)
+{
+    double root = (value > 1.0) ? value : 1.0;
+    for (int idx = 0; idx < 64 && value > 0.0; ++idx)
+    {
+        root = 0.5 * (root + value / root);
+    }
+    return (value > 0.0) ? root : 0.0;
+}
 
-#define mcu_assert_equal_string(data, expected) \
-    MCU_ASSERT_EQUAL_STRING_BASE(data, expected)
+static inline unsigned long long mcu_soak_env(const char* name, unsigned long long default_value)
+{
+    const char* value = getenv(name);
+    return (value != NULL && value[0] != '\0') ? strtoull(value, NULL, 0) : default_value;
+}
 
-#define mcu_assert_not_equal_string(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_STRING_BASE(data, expected)
+///
+/// \brief Register a test_case in the test_suite. Called by test_case_run
+///
+static inline void mcu_soak_register(struct mcu_soak_case* cases, size_t* nb_cases, const char* name, void (*run)(const char* const, size_t*, size_t*))
+{
+    const char* filter = getenv("MCU_SOAK_FILTER");
+    if (*nb_cases >= MCU_SOAK_MAX_CASES || (filter != NULL && strstr(name, filter) == NULL))
+    {
+        return;
+    }
+    memset(&cases[*nb_cases], 0, sizeof(cases[*nb_cases]));
+    cases[*nb_cases].name = name;
+    cases[*nb_cases].run = run;
+    *nb_cases += 1;
+}
+
+///
+/// \brief Run the registered test_cases and print the soak report. Called by TEST_SUITE_END
+///
+static inline void mcu_soak_run(struct mcu_soak_case* cases, size_t nb_cases, const char* const test_suite, size_t* nb_tests, size_t* nb_failed)
+{
+    const char* duration_env = getenv("MCU_SOAK_DURATION");
+    const uint64_t duration_ns = (duration_env != NULL) ? (uint64_t)(atof(duration_env) * 1e9) : 0;
+    const unsigned long long iterations = mcu_soak_env("MCU_SOAK_ITERATIONS", (duration_ns > 0) ? ~0ULL : MCU_SOAK_DEFAULT_ITERATIONS);
+    const int shuffle = (int)mcu_soak_env("MCU_SOAK_SHUFFLE", MCU_SOAK_DEFAULT_SHUFFLE);
+    const uint64_t base_seed = mcu_soak_env("MCU_SOAK_SEED", mcu_time_ns() ^ (uint64_t)(size_t)cases);
+    size_t order[MCU_SOAK_MAX_CASES];
+
+    mcu_soak_quiet = !mcu_soak_env("MCU_SOAK_VERBOSE", 0);
+
+    const uint64_t start = mcu_time_ns();
+    unsigned long long iteration = 0;
+    for (; iteration < iterations && (duration_ns == 0 || mcu_time_ns() - start < duration_ns); ++iteration)
+    {
+        uint64_t state = base_seed + iteration;
+        const uint64_t seed = (iteration == 0) ? base_seed : mcu_soak_next(&state);
+
+        state = seed;
+        for (size_t idx = 0; idx < nb_cases; ++idx)
+        {
+            order[idx] = idx;
+        }
+        for (size_t idx = nb_cases; shuffle && idx > 1; --idx)
+        {
+            const size_t other = (size_t)(mcu_soak_next(&state) % idx);
+            const size_t tmp = order[idx - 1];
+            order[idx - 1] = order[other];
+            order[other] = tmp;
+        }
+        srand((unsigned int)seed);
+
+        for (size_t idx = 0; idx < nb_cases; ++idx)
+        {
+            struct mcu_soak_case* tc = &cases[order[idx]];
+            const size_t failed_before = *nb_failed;
+            const uint64_t tc_start = mcu_time_ns();
+            tc->run(test_suite, nb_tests, nb_failed);
+            const double elapsed = (double)(mcu_time_ns() - tc_start);
+
+            tc->nb_runs += 1;
+            const double delta = elapsed - tc->mean_ns;
+            tc->mean_ns += delta / (double)tc->nb_runs;
+            tc->m2_ns += delta * (elapsed - tc->mean_ns);
+            if (*nb_failed != failed_before)
+            {
+                if (tc->nb_failed_runs == 0)
+                {
+                    tc->first_failure_seed = seed;
+                }
+                tc->nb_failed_runs += 1;
+            }
+        }
+    }
 
+    mcu_soak_quiet = 0;
+
+    LOG_FUNCTION(YEL "SOAK REPORT %s - %llu runs%s, seed 0x%llx\n" RESET, test_suite, iteration, shuffle ? " (shuffled)" : "", (unsigned long long)base_seed);
+    for (size_t idx = 0; idx < nb_cases; ++idx)
+    {
+        const struct mcu_soak_case* tc = &cases[idx];
+        const double stddev = (tc->nb_runs > 1) ? mcu_soak_sqrt(tc->m2_ns / (double)(tc->nb_runs - 1)) : 0.0;
+        const double cv = (tc->mean_ns > 0.0) ? 100.0 * stddev / tc->mean_ns : 0.0;
+        const size_t nb_passed = tc->nb_runs - tc->nb_failed_runs;
+
+        if (tc->nb_failed_runs == 0)
+        {
+            LOG_FUNCTION("  %s : " GRN "STABLE" RESET " %lu/%lu passed", tc->name, nb_passed, tc->nb_runs);
+        }
+        else if (nb_passed == 0)
+        {
+            LOG_FUNCTION("  %s : " RED TEST_FAILED RESET " %lu/%lu passed, seed 0x%llx", tc->name, nb_passed, tc->nb_runs, (unsigned long long)tc->first_failure_seed);
+        }
+        else
+        {
+            LOG_FUNCTION("  %s : " RED "FLAKY" RESET " %lu/%lu passed (%.1f %%), first failure with seed 0x%llx", tc->name, nb_passed, tc->nb_runs,
+                         100.0 * (double)nb_passed / (double)tc->nb_runs, (unsigned long long)tc->first_failure_seed);
+        }
+        LOG_FUNCTION(" - mean %.0f ns, cv %.1f %%\n", tc->mean_ns, cv);
+    }
+}
 
-#define mcu_assert_equal_ptr(data, expected) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(ptr, data, expected)
+#define MCU_SOAK_SUITE_BEGIN() \
+        struct mcu_soak_case mcu_soak_cases[MCU_SOAK_MAX_CASES]; \
+        size_t mcu_soak_nb_cases = 0;
 
-#define mcu_assert_not_equal_ptr(data, expected) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ptr, data, expected)
+#define MCU_SOAK_SUITE_END() \
+        mcu_soak_run(mcu_soak_cases, mcu_soak_nb_cases, __func__, &nbr_tests, &nbr_failed);
 
-#define mcu_assert_null_ptr(pointer) \
-    MCU_ASSERT_EQUAL_TYPE_BASE(ptr, pointer, NULL)
+#else
 
-#define mcu_assert_not_null_ptr(pointer) \
-    MCU_ASSERT_NOT_EQUAL_TYPE_BASE(ptr, pointer, NULL)
+#define MCU_SOAK_SUITE_BEGIN()
+#define MCU_SOAK_SUITE_END()
 
+#endif // MCU_SOAK
 
-#define mcu_assert_equal_size_t(data, expected) \
-    mcu_assert_equal_ulong(data, expected)
 
-#define mcu_assert_not_equal_size_t(data, expected) \
-    mcu_assert_not_equal_ulong(data, expected)
 
 
-#define mcu_assert_equal_float(data, expected, precision) \
-    MCU_ASSERT_EQUAL_FLOAT_BASE(data, expected, precision)
+////////////////////////////////////////////////////////////////////
+///                                                              ///
+///                    DIFFERENTIAL TESTING                      ///
+///                                                              ///
+////////////////////////////////////////////////////////////////////
 
-// expects the relative_precision expressed in %
-#define mcu_assert_equal_float_rel(data, expected, rel_precision) \
-    MCU_ASSERT_EQUAL_FLOAT_BASE(data, expected, ((rel_precision) * ((expected) < 0.0 ? -(expected) : (expected)) ))
+// A diff case checks an optimized implementation against a reference one : the same inputs, given by a generator
+// (random or recorded), are fed to both functions and their outputs compared. The first diverging input is reported,
+// and both sides are timed to report the speedup, which can also be asserted.
+// Functions are used by value :
+//      INPUT  generator(size_t index);
+//      OUTPUT ref_fn(INPUT input);
+//      OUTPUT opt_fn(INPUT input);
+// Inputs and outputs are processed by batches of MCU_DIFF_BATCH held in the scratch arena, so that each side is timed
+// over a whole batch rather than per call. Batches alternate the side run first.
+
+#ifndef MCU_DIFF_SAMPLES
+#define MCU_DIFF_SAMPLES (1000)
+#endif
 
+#ifndef MCU_DIFF_BATCH
+#define MCU_DIFF_BATCH (64)
+#endif
 
-#define mcu_assert_equal_double(data, expected, precision) \
-    MCU_ASSERT_EQUAL_DOUBLE_BASE(data, expected, precision)
 
-// expects the relative_precision expressed in %
-#define mcu_assert_equal_double_rel(data, expected, rel_precision) \
-    MCU_ASSERT_EQUAL_DOUBLE_BASE(data, expected, ((rel_precision) * ((expected) < 0.0 ? -(expected) : (expected)) ))
+///
+/// \brief Begin the definition of a diff case : a test_case, run with test_case_run(name)
+///         The body may configure the case with mcu_diff_set_* before DIFF_CASE_END
+///
+/// \param[in] name shortname of the test_case
+/// \param[in] ref_fn Reference implementation
+/// \param[in] opt_fn Optimized implementation, same signature as ref_fn
+/// \param[in] generator Returns the input of the given index. Called MCU_DIFF_SAMPLES times by default
+///
+#define DIFF_CASE_BEGIN(name, ref_fn, opt_fn, generator) \
+    TEST_CASE_BEGIN(name) \
+        typedef MCU_TYPEOF((generator)((size_t)0)) mcu_diff_input_t; \
+        typedef MCU_TYPEOF((ref_fn)((generator)((size_t)0))) mcu_diff_output_t; \
+        mcu_diff_input_t (*const mcu_diff_generator)(size_t) = (generator); \
+        mcu_diff_output_t (*const mcu_diff_ref)(mcu_diff_input_t) = (ref_fn); \
+        mcu_diff_output_t (*const mcu_diff_opt)(mcu_diff_input_t) = (opt_fn); \
+        const char* const mcu_diff_ref_name = #ref_fn; \
+        const char* const mcu_diff_opt_name = #opt_fn; \
+        int (*mcu_diff_cmp)(mcu_diff_output_t, mcu_diff_output_t) = NULL; \
+        void (*mcu_diff_printer)(mcu_diff_input_t, mcu_diff_output_t, mcu_diff_output_t) = NULL; \
+        size_t mcu_diff_samples = MCU_DIFF_SAMPLES; \
+        double mcu_diff_min_speedup = 0.0;
+
+
+///
+/// \brief Finalize the definition of a diff case : runs both implementations and checks them
+///
+#define DIFF_CASE_END() \
+        do { \
+            mcu_diff_input_t* const mcu_diff_inputs = (mcu_diff_input_t*)mcu_alloc(MCU_DIFF_BATCH * sizeof(mcu_diff_input_t)); \
+            mcu_diff_output_t* const mcu_diff_ref_outputs = (mcu_diff_output_t*)mcu_alloc(MCU_DIFF_BATCH * sizeof(mcu_diff_output_t)); \
+            mcu_diff_output_t* const mcu_diff_opt_outputs = (mcu_diff_output_t*)mcu_alloc(MCU_DIFF_BATCH * sizeof(mcu_diff_output_t)); \
+            if (mcu_diff_inputs == NULL || mcu_diff_ref_outputs == NULL || mcu_diff_opt_outputs == NULL) \
+            { \
+                MCU_ASSERT_BASE(test_suite, __func__, 0, "\"Scratch memory for the inputs and outputs of the diff case\""); \
+                break; \
+            } \
+            uint64_t mcu_diff_ref_ns = 0; \
+            uint64_t mcu_diff_opt_ns = 0; \
+            size_t mcu_diff_nb_diverging = 0; \
+            for (size_t mcu_diff_first = 0; mcu_diff_first < mcu_diff_samples; mcu_diff_first += MCU_DIFF_BATCH) \
+            { \
+                const size_t mcu_diff_batch = (mcu_diff_samples - mcu_diff_first < MCU_DIFF_BATCH) ? mcu_diff_samples - mcu_diff_first : MCU_DIFF_BATCH; \
+                for (size_t idx = 0; idx < mcu_diff_batch; ++idx) \
+                { \
+                    mcu_diff_inputs[idx] = mcu_diff_generator(mcu_diff_first + idx); \
+                } \
+                for (int mcu_diff_side = 0; mcu_diff_side < 2; ++mcu_diff_side) \
+                { \
+                    const int mcu_diff_run_ref = (mcu_diff_side == 0) == ((mcu_diff_first / MCU_DIFF_BATCH) % 2 == 0); \
+                    mcu_diff_output_t (*const mcu_diff_fn)(mcu_diff_input_t) = mcu_diff_run_ref ? mcu_diff_ref : mcu_diff_opt; \
+                    mcu_diff_output_t* const mcu_diff_outputs = mcu_diff_run_ref ? mcu_diff_ref_outputs : mcu_diff_opt_outputs; \
+                    const uint64_t mcu_diff_start = mcu_time_ns(); \
+                    for (size_t idx = 0; idx < mcu_diff_batch; ++idx) \
+                    { \
+                        mcu_diff_outputs[idx] = mcu_diff_fn(mcu_diff_inputs[idx]); \
+                    } \
+                    *(mcu_diff_run_ref ? &mcu_diff_ref_ns : &mcu_diff_opt_ns) += mcu_time_ns() - mcu_diff_start; \
+                } \
+                for (size_t idx = 0; idx < mcu_diff_batch; ++idx) \
+                { \
+                    const int mcu_diff_equal = (mcu_diff_cmp != NULL) ? !!mcu_diff_cmp(mcu_diff_opt_outputs[idx], mcu_diff_ref_outputs[idx]) \
+                                                                      : (memcmp(&mcu_diff_opt_outputs[idx], &mcu_diff_ref_outputs[idx], sizeof(mcu_diff_output_t)) == 0); \
+                    if (!mcu_diff_equal && mcu_diff_nb_diverging++ == 0) \
+                    { \
+                        MCU_ASSERT_BASE(test_suite, __func__, 0, "\"Optimized and reference outputs are equal\""); \
+                        char mcu_diff_report[160]; \
+                        snprintf(mcu_diff_report, sizeof(mcu_diff_report), "First diverging input : generator(%lu)", (unsigned long)(mcu_diff_first + idx)); \
+                        mcu_log(mcu_diff_report); \
+                        if (mcu_diff_printer != NULL) \
+                        { \
+                            mcu_diff_printer(mcu_diff_inputs[idx], mcu_diff_ref_outputs[idx], mcu_diff_opt_outputs[idx]); \
+                        } \
+                    } \
+                } \
+            } \
+            char mcu_diff_report[160]; \
+            if (mcu_diff_nb_diverging == 0) \
+            { \
+                MCU_ASSERT_BASE(test_suite, __func__, 1, "\"Optimized and reference outputs are equal\""); \
+            } \
+            else \
+            { \
+                snprintf(mcu_diff_report, sizeof(mcu_diff_report), "%lu / %lu inputs diverge", (unsigned long)mcu_diff_nb_diverging, (unsigned long)mcu_diff_samples); \
+                mcu_log(mcu_diff_report); \
+            } \
+            const double mcu_diff_samples_count = (mcu_diff_samples > 0) ? (double)mcu_diff_samples : 1.0; \
+            const double mcu_diff_speedup = (mcu_diff_opt_ns > 0) ? (double)mcu_diff_ref_ns / (double)mcu_diff_opt_ns : 0.0; \
+            snprintf(mcu_diff_report, sizeof(mcu_diff_report), "%s : %.1f ns, %s : %.1f ns per call, speedup x%.2f", \
+                     mcu_diff_ref_name, (double)mcu_diff_ref_ns / mcu_diff_samples_count, \
+                     mcu_diff_opt_name, (double)mcu_diff_opt_ns / mcu_diff_samples_count, mcu_diff_speedup); \
+            mcu_log(mcu_diff_report); \
+            if (mcu_diff_min_speedup > 0.0) \
+            { \
+                MCU_ASSERT_BASE(test_suite, __func__, (mcu_diff_speedup >= mcu_diff_min_speedup), "\"Speedup of the optimized implementation is above the minimum\""); \
+            } \
+        } while (0); \
+    TEST_CASE_END()
 
 
+//-----------------------//
+//---- DIFF CASE API ----//
+//-----------------------//
 
 ///
-/// \brief Check if two variables are "equal" based on custom comparison function
-///
-/// \param[in] cmp_function Hookup function which does the comparison of data and expected variables
+/// \brief Number of inputs generated, with indexes from 0 to count - 1 (e.g. number of recorded inputs)
 ///
-#define mcu_assert_equal_custom_cmp(cmp_function, data, expected) \
-    MCU_ASSERT_BASE(test_suite, __func__, ((cmp_function)((data), (expected))), "\""#data" == "#expected"\"")
-
-#define mcu_assert_not_equal_custom_cmp(cmp_function, data, expected) \
-    MCU_ASSERT_BASE(test_suite, __func__, !((cmp_function)((data), (expected))), "\""#data" != "#expected"\"")
+#define mcu_diff_set_samples(count) \
+    mcu_diff_samples = (size_t)(count)
 
 ///
-/// \brief Check if two variables are "equal" based on custom comparison function
-///         Prints custom message if assert fails
-///
-/// \param[in] cmp_function Hookup function which does the comparison of data and expected variables
+/// \brief Compare the outputs with cmp_function(opt_output, ref_output), non zero if "equal", as mcu_assert_equal_custom_cmp
+///         Outputs are compared byte per byte (memcmp) by default
 ///
-#define mcu_assert_equal_custom_cmp_message(cmp_function, data, expected, message) \
-    MCU_ASSERT_BASE(test_suite, __func__, ((cmp_function)((data), (expected))), message)
-
-
-
-#define mcu_assert_equal_int_array(data, expected, size) \
-    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, !((data)[idx] == (expected)[idx]), size)
-
-#define mcu_assert_equal_int_array_each(data, expected, size) \
-    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, !((data)[idx] == (expected)), size)
-
-#define mcu_assert_equal_custom_cmp_array(cmp_function, data, expected, size) \
-    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, !((cmp_function)(((data)[idx]), ((expected)[idx]))), size)
-
-#define mcu_assert_equal_custom_cmp_array_each(cmp_function, data, expected, size) \
-    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, !((cmp_function)(((data)[idx]), (expected))), size)
-
-#define mcu_assert_equal_float_array(data, expected, precision, size) \
-    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, (((data)[idx] - (expected)[idx]) < 0 ? ((expected)[idx] - (data)[idx]) : ((data)[idx] - (expected)[idx])) > (precision), size)
-
-#define mcu_assert_equal_float_array_each(data, expected, precision, size) \
-    MCU_ASSERT_EQUAL_ARRAY_BASE(data, expected, (((data)[idx] - (expected)) < 0 ? ((expected) - (data)[idx]) : ((data)[idx] - (expected))) > (precision), size)
+#define mcu_diff_set_comparator(cmp_function) \
+    mcu_diff_cmp = (cmp_function)
 
+///
+/// \brief Called with the first diverging input, and the outputs of ref_fn and opt_fn, to print them
+///
+#define mcu_diff_set_printer(print_function) \
+    mcu_diff_printer = (print_function)
 
+///
+/// \brief Fail if ref_fn is not at least speedup times slower than opt_fn
+///
+#define mcu_diff_set_min_speedup(speedup) \
+    mcu_diff_min_speedup = (double)(speedup)
 
 
 
@@ -596,8 +2688,10 @@ static char group_report[500000]; // should be long enough to hold full report
     { \
         size_t start_nb_tests = *nb_tests;        \
         size_t start_nb_failed = *nb_failed;      \
-        LOG_FUNCTION(CYN "TEST CASE %s...\n" RESET, ""#name"");  \
-        LOG_FUNCTION(CYN "---\n" RESET);
+        mcu_arena_reset(&mcu_arena); \
+        mcu_clock_reset(); \
+        MCU_LOG_CASE_BEGIN(name) \
+        MCU_NOTIFY(MCU_EVENT_CASE_BEGIN, test_suite, __func__, __FILENAME__, __LINE__, NULL, 0, NULL, NULL, 0, 0);
 
 ///
 /// \brief Finalize the  definition of a test case.
@@ -605,20 +2699,14 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 ///
 #define TEST_CASE_END() \
+    mcu_test_case_end: MCU_UNUSED_LABEL; \
         size_t nb_test_tc = *nb_tests - start_nb_tests; \
         size_t nb_test_tc_failed = *nb_failed - start_nb_failed; \
-        size_t nb_test_tc_passed = nb_test_tc - nb_test_tc_failed; \
         \
-        if (nb_test_tc_failed > 0)    \
-        {   \
-            LOG_FUNCTION(CYN "--- " RED TEST_FAILED RESET" - %lu tests : %lu passed, %lu failed " CYN "---\n" RESET, nb_test_tc, nb_test_tc_passed, nb_test_tc_failed); \
-            LOG_FUNCTION("\n"); \
-        }   \
-        else    \
-        {   \
-            LOG_FUNCTION(CYN "--- " GRN TEST_PASSED RESET " - %lu passed " CYN " ---\n" RESET , nb_test_tc_passed); \
-            LOG_FUNCTION("\n"); \
-        }   \
+        MCU_LOG_CASE_END(nb_test_tc, nb_test_tc_failed) \
+        MCU_NOTIFY(MCU_EVENT_CASE_END, test_suite, __func__, __FILENAME__, __LINE__, NULL, 0, NULL, NULL, nb_test_tc, nb_test_tc_failed); \
+        mcu_arena_reset(&mcu_arena); \
+        mcu_clock_reset(); \
     }
 
 
@@ -630,8 +2718,13 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 /// \param[in] name shortname of the test_case to run
 ///
+#ifndef MCU_SOAK
 #define test_case_run(tc) \
     test_case_##tc(__func__, &nbr_tests, &nbr_failed)
+#else
+#define test_case_run(tc) \
+    mcu_soak_register(mcu_soak_cases, &mcu_soak_nb_cases, ""#tc"", test_case_##tc)
+#endif
 
 
 
@@ -657,8 +2750,10 @@ static char group_report[500000]; // should be long enough to hold full report
     { \
         size_t nbr_tests = 0; \
         size_t nbr_failed = 0;    \
-        LOG_FUNCTION(YEL "TEST SUITE %s \n" RESET, ""#name"");   \
-        LOG_FUNCTION(YEL "===========================================================\n" RESET);
+        MCU_SOAK_SUITE_BEGIN() \
+        MCU_FLIGHT_RECORDER_SUITE_BEGIN() \
+        MCU_LOG_SUITE_BEGIN(name) \
+        MCU_NOTIFY(MCU_EVENT_SUITE_BEGIN, __func__, NULL, __FILENAME__, __LINE__, NULL, 0, NULL, NULL, 0, 0);
 
 
 ///
@@ -667,16 +2762,10 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 ///
 #define TEST_SUITE_END() \
-        if(nbr_failed != 0) \
-        { \
-            LOG_FUNCTION( YEL "================ KO - %lu tests :  %lu passed, %lu failed =================\n\n" RESET, nbr_tests, nbr_tests - nbr_failed, nbr_failed); \
-            return TEST_FAILED; \
-        } \
-        else \
-        { \
-            LOG_FUNCTION(YEL "================ OK -  %lu passed =================\n\n" RESET, nbr_tests); \
-            return TEST_PASSED; \
-        } \
+        MCU_SOAK_SUITE_END() \
+        MCU_LOG_SUITE_END(nbr_tests, nbr_failed) \
+        MCU_NOTIFY(MCU_EVENT_SUITE_END, __func__, NULL, __FILENAME__, __LINE__, NULL, 0, NULL, NULL, nbr_tests, nbr_failed); \
+        return (nbr_failed != 0) ? TEST_FAILED : TEST_PASSED; \
     }
 
 
@@ -698,6 +2787,7 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 /// \param[in] name shortname of the test_case to run
 ///
+#ifndef MCU_BINARY_LOG
 #define TEST_SUITE_RUN_IN_GROUP(name) \
     do { \
         strcat(group_report, ""#name""); \
@@ -715,6 +2805,12 @@ static char group_report[500000]; // should be long enough to hold full report
         strcat(group_report, RESET); \
         strcat(group_report, "\n"); \
     } while (0)
+#else
+#define TEST_SUITE_RUN_IN_GROUP(name) \
+    do { \
+        TEST_SUITE_RUN_OUT_OF_GROUP(name); \
+    } while (0)
+#endif
 
 
 ///
@@ -741,18 +2837,34 @@ static char group_report[500000]; // should be long enough to hold full report
 ///
 /// \param[in] name The name of the group of test_suites
 ///
+#ifndef MCU_BINARY_LOG
 #define test_group_initialize(name) \
     do { \
         sprintf(group_report, "UNITTEST GROUP %s \n**********\n", ""#name""); \
     } while (0)
+#else
+#define test_group_initialize(name) \
+    do { \
+        MCU_BIN_DESCRIPTOR(#name); \
+        group_report[0] = 'G'; \
+        mcu_bin_emit(MCU_BIN_GROUP_BEGIN, mcu_bin_descriptor, NULL, 0); \
+    } while (0)
+#endif
 
 
 /// \brief Finalize and print the log report for overview of all test_suites report (only OK/KO with no verbosity)
 ///
 ///
+#ifndef MCU_BINARY_LOG
 #define test_group_finalize() \
     do { \
         LOG_FUNCTION(group_report); \
     } while (0)
+#else
+#define test_group_finalize() \
+    do { \
+        mcu_bin_emit(MCU_BIN_GROUP_END, NULL, NULL, 0); \
+    } while (0)
+#endif
 
 #endif  /*  __MINICUTEST_H__ */
@@ -0,0 +1,384 @@
+/*  MINCUTEST  - MINImalist C UnitTEST framework
+*
+* Host-side decoder of the binary log stream produced with MCU_BINARY_LOG.
+* Reads the "mcu_log_str" section of the ELF file of the test binary and
+* rebuilds the human-readable report of the text backend.
+*
+* Usage : mcu_decode [-n] <elf_file> [binary_log_file]
+*           -n : no ANSI coloration (same as ANSI_NOT_SUPPORTED on target)
+*           binary_log_file defaults to stdin
+*
+* Copyright © 2021 florian[dot]valenza[at]gmail[dot]com
+* See LICENSE for the terms of use.
+*/
+
+#include <elf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MCU_BINARY_LOG
+#include <minicutest/minicutest.h>
+
+
+///
+/// \brief Descriptor section of the ELF file
+///
+typedef struct
+{
+    char* data;
+    size_t size;
+} descriptor_section;
+
+///
+/// \brief ANSI tags, emptied with -n
+///
+static const char* red = RED;
+static const char* grn = GRN;
+static const char* yel = YEL;
+static const char* mag = MAG;
+static const char* cyn = CYN;
+static const char* reset = RESET;
+
+
+static char* read_file(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *size = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* content = malloc(*size);
+    if (content != NULL && fread(content, 1, *size, file) != *size)
+    {
+        free(content);
+        content = NULL;
+    }
+    fclose(file);
+    return content;
+}
+
+
+///
+/// \brief Find the "mcu_log_str" section. Handles 32 and 64 bits ELF files
+///
+/// \return 0 on success
+///
+static int load_descriptor_section(const char* elf, size_t elf_size, descriptor_section* section)
+{
+    if (elf_size < EI_NIDENT || memcmp(elf, ELFMAG, SELFMAG) != 0)
+    {
+        return -1;
+    }
+
+#define FIND_SECTION(Ehdr, Shdr) \
+    do { \
+        const Ehdr* header = (const Ehdr*)elf; \
+        const Shdr* sections = (const Shdr*)(elf + header->e_shoff); \
+        const char* names = elf + sections[header->e_shstrndx].sh_offset; \
+        for (size_t idx = 0; idx < header->e_shnum; ++idx) \
+        { \
+            if (strcmp(names + sections[idx].sh_name, "mcu_log_str") == 0) \
+            { \
+                section->data = (char*)elf + sections[idx].sh_offset; \
+                section->size = sections[idx].sh_size; \
+                return 0; \
+            } \
+        } \
+    } while (0)
+
+    if (elf[EI_CLASS] == ELFCLASS64)
+    {
+        FIND_SECTION(Elf64_Ehdr, Elf64_Shdr);
+    }
+    else
+    {
+        FIND_SECTION(Elf32_Ehdr, Elf32_Shdr);
+    }
+
+#undef FIND_SECTION
+
+    return -1;
+}
+
+
+static int read_u32(FILE* stream, uint32_t* value)
+{
+    unsigned char bytes[4];
+    if (fread(bytes, 1, 4, stream) != 4)
+    {
+        return -1;
+    }
+    *value = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    return 0;
+}
+
+
+///
+/// \brief Read one [len : u8][bytes] operand
+///
+static int read_operand(FILE* stream, unsigned char* bytes, size_t* size)
+{
+    int length = fgetc(stream);
+    if (length == EOF)
+    {
+        return -1;
+    }
+    *size = (size_t)length;
+    return (fread(bytes, 1, *size, stream) == *size) ? 0 : -1;
+}
+
+
+///
+/// \brief Print one raw operand with the printf format used by the text backend for this tag
+///
+static void print_operand(unsigned char tag, const unsigned char* bytes, size_t size)
+{
+    unsigned long long raw = 0;
+    for (size_t idx = 0; idx < size && idx < sizeof(raw); ++idx)
+    {
+        raw |= (unsigned long long)bytes[idx] << (8 * idx);
+    }
+    // Sign extension for signed types narrower than long long
+    long long signed_raw = (long long)raw;
+    if (size > 0 && size < sizeof(raw) && (bytes[size - 1] & 0x80))
+    {
+        signed_raw = (long long)(raw | (~0ULL << (8 * size)));
+    }
+
+    switch (tag)
+    {
+        case MCU_TAG_char:
+        case MCU_TAG_uchar:
+            printf("%c", (char)raw);
+            break;
+        case MCU_TAG_short:
+        case MCU_TAG_int:
+        case MCU_TAG_long:
+        case MCU_TAG_llong:
+            printf("%lli", signed_raw);
+            break;
+        case MCU_TAG_ushort:
+        case MCU_TAG_uint:
+        case MCU_TAG_ulong:
+        case MCU_TAG_ullong:
+        case MCU_TAG_size_t:
+            printf("%llu", raw);
+            break;
+        case MCU_TAG_string:
+            printf("%.*s", (int)size, (const char*)bytes);
+            break;
+        case MCU_TAG_ptr:
+            if (raw == 0)
+            {
+                printf("(nil)");
+            }
+            else
+            {
+                printf("0x%llx", raw);
+            }
+            break;
+        case MCU_TAG_float:
+        case MCU_TAG_double:
+            if (size == sizeof(float))
+            {
+                float value;
+                memcpy(&value, bytes, sizeof(value));
+                printf("%f", value);
+            }
+            else
+            {
+                double value;
+                memcpy(&value, bytes, sizeof(value));
+                printf("%lf", value);
+            }
+            break;
+        default:
+            printf("<unknown tag %u>", tag);
+            break;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "-n") == 0)
+    {
+        red = grn = yel = mag = cyn = reset = "";
+        ++arg;
+    }
+    if (arg >= argc)
+    {
+        fprintf(stderr, "Usage : %s [-n] <elf_file> [binary_log_file]\n", argv[0]);
+        return 2;
+    }
+
+    size_t elf_size = 0;
+    char* elf = read_file(argv[arg], &elf_size);
+    descriptor_section section;
+    if (elf == NULL || load_descriptor_section(elf, elf_size, &section) != 0)
+    {
+        fprintf(stderr, "%s : cannot find section mcu_log_str\n", argv[arg]);
+        return 1;
+    }
+
+    FILE* stream = (arg + 1 < argc) ? fopen(argv[arg + 1], "rb") : stdin;
+    if (stream == NULL)
+    {
+        fprintf(stderr, "%s : cannot open\n", argv[arg + 1]);
+        return 1;
+    }
+
+    const char* suite = "";
+    const char* test_case = "";
+    int in_group = 0;
+    size_t overview_size = 0;
+    char* overview = NULL;
+
+    int kind;
+    while ((kind = fgetc(stream)) != EOF)
+    {
+        uint32_t id = 0;
+        if (read_u32(stream, &id) != 0)
+        {
+            break;
+        }
+
+        const char* file = "";
+        const char* text = "";
+        if (id != MCU_BIN_NO_DESCRIPTOR && id < section.size)
+        {
+            file = section.data + id;
+            text = file + strlen(file) + 1;
+            file = strrchr(file, '/') ? strrchr(file, '/') + 1 : file;
+        }
+
+        uint32_t values[3] = {0, 0, 0};
+        unsigned char data[256], expected[256];
+        size_t data_size = 0, expected_size = 0;
+        int tag;
+
+        switch (kind)
+        {
+            case MCU_BIN_GROUP_BEGIN:
+                in_group = 1;
+                free(overview);
+                overview_size = strlen(text) + 32;
+                overview = malloc(overview_size);
+                snprintf(overview, overview_size, "UNITTEST GROUP %s \n**********\n", text);
+                break;
+
+            case MCU_BIN_GROUP_END:
+                if (overview != NULL)
+                {
+                    printf("%s", overview);
+                }
+                in_group = 0;
+                break;
+
+            case MCU_BIN_SUITE_BEGIN:
+                suite = text;
+                printf("%sTEST SUITE %s \n%s", yel, suite, reset);
+                printf("%s===========================================================\n%s", yel, reset);
+                break;
+
+            case MCU_BIN_SUITE_END:
+                if (read_u32(stream, &values[0]) != 0 || read_u32(stream, &values[1]) != 0)
+                {
+                    goto truncated;
+                }
+                if (values[1] != 0)
+                {
+                    printf("%s================ KO - %u tests :  %u passed, %u failed =================\n\n%s", yel, values[0], values[0] - values[1], values[1], reset);
+                }
+                else
+                {
+                    printf("%s================ OK -  %u passed =================\n\n%s", yel, values[0], reset);
+                }
+                if (in_group)
+                {
+                    const size_t used = strlen(overview);
+                    overview_size = used + strlen(suite) + 64;
+                    overview = realloc(overview, overview_size);
+                    snprintf(overview + used, overview_size - used, "%s...%s%s%s\n", suite,
+                             values[1] != 0 ? red : grn, values[1] != 0 ? TEST_FAILED : TEST_PASSED, reset);
+                }
+                break;
+
+            case MCU_BIN_CASE_BEGIN:
+                test_case = text;
+                printf("%sTEST CASE %s...\n%s", cyn, test_case, reset);
+                printf("%s---\n%s", cyn, reset);
+                break;
+
+            case MCU_BIN_CASE_END:
+                if (read_u32(stream, &values[0]) != 0 || read_u32(stream, &values[1]) != 0)
+                {
+                    goto truncated;
+                }
+                if (values[1] > 0)
+                {
+                    printf("%s--- %s" TEST_FAILED "%s - %u tests : %u passed, %u failed %s---\n%s\n", cyn, red, reset, values[0], values[0] - values[1], values[1], cyn, reset);
+                }
+                else
+                {
+                    printf("%s--- %s" TEST_PASSED "%s - %u passed %s ---\n%s\n", cyn, grn, reset, values[0], cyn, reset);
+                }
+                break;
+
+            case MCU_BIN_ASSERT_FAILED:
+                if (read_u32(stream, &values[0]) != 0)
+                {
+                    goto truncated;
+                }
+                printf("%s::test_suite_%s::test_case_%s:%u - Assertion failed : %s \n", file, suite, test_case, values[0], text);
+                break;
+
+            case MCU_BIN_ARRAY_FAILED:
+                if (read_u32(stream, &values[0]) != 0 || read_u32(stream, &values[1]) != 0 || read_u32(stream, &values[2]) != 0)
+                {
+                    goto truncated;
+                }
+                printf("%s::test_suite_%s::test_case_%s:%u - Assertion failed : %s : %s%u ko / %u %s \n", file, suite, test_case, values[0], text, mag, values[1], values[2], reset);
+                break;
+
+            case MCU_BIN_VALUES:
+                tag = fgetc(stream);
+                if (tag == EOF || read_operand(stream, data, &data_size) != 0 || read_operand(stream, expected, &expected_size) != 0)
+                {
+                    goto truncated;
+                }
+                printf("%sExpected ", mag);
+                print_operand((unsigned char)tag, expected, expected_size);
+                printf(" , obtained ");
+                print_operand((unsigned char)tag, data, data_size);
+                printf("%s\n", reset);
+                break;
+
+            case MCU_BIN_MESSAGE:
+                if (read_operand(stream, data, &data_size) != 0)
+                {
+                    goto truncated;
+                }
+                printf("%.*s\n", (int)data_size, (const char*)data);
+                break;
+
+            default:
+                fprintf(stderr, "Unknown record kind %d, stream out of sync\n", kind);
+                return 1;
+        }
+    }
+
+    free(overview);
+    free(elf);
+    return 0;
+
+truncated:
+    fprintf(stderr, "Truncated binary log stream\n");
+    return 1;
+}